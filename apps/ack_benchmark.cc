@@ -0,0 +1,58 @@
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+//! Where each measurement's result goes, so that the loop cannot be optimized away
+static volatile size_t result_sink = 0;
+
+//! Emit `count` pure ACKs (with timestamps, as a connection that negotiated them sends) through
+//! `serialize`, which returns the serialized length; \returns ns per ACK
+template <typename Serialize>
+static double ns_per_ack(const size_t count, Serialize &&serialize) {
+    TCPSegment seg;
+    seg.header().ack = true;
+    seg.header().seqno = WrappingInt32{1000};
+    seg.header().ts = TCPHeader::Timestamps{1, 2};
+    size_t sink = 0;
+    const auto start = steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+        seg.header().ackno = WrappingInt32{static_cast<uint32_t>(i * 1460)};
+        seg.header().win = static_cast<uint16_t>(i);
+        seg.header().ts->val = static_cast<uint32_t>(i);
+        sink += serialize(seg);
+    }
+    const auto elapsed = duration_cast<duration<double, nano>>(steady_clock::now() - start).count();
+    result_sink = sink;
+    return elapsed / static_cast<double>(count);
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        const size_t count = argc > 1 ? stoul(argv[1]) : 10'000'000;
+        // both paths of TCPOverIPv4OverTunFdAdapter::write(), which take the connection from the configuration
+        TCPOverIPv4Adapter adapter;
+        adapter.config_mut().source = {"10.0.0.1", 4242};
+        adapter.config_mut().destination = {"10.0.0.2", 80};
+
+        cout << "Pure ACK serialization, " << count << " ACKs per measurement (ns per ACK)\n\n" << fixed
+             << setprecision(1);
+        cout << left << setw(40) << "serialize_tcp_in_ip (headers built)" << right << setw(8)
+             << ns_per_ack(count, [&](TCPSegment &seg) { return adapter.serialize_tcp_in_ip(seg).size(); }) << "\n";
+        cout << left << setw(40) << "serialize_ack (template patched)" << right << setw(8)
+             << ns_per_ack(count, [&](TCPSegment &seg) { return adapter.serialize_ack(seg).size(); }) << "\n";
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#include "util.hh"
+
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+using Kernel = InternetChecksum::Kernel;
+
+static const vector<pair<Kernel, string>> KERNELS = {
+    {Kernel::Bytewise, "bytewise"}, {Kernel::Words, "words"}, {Kernel::SSE2, "sse2"}, {Kernel::AVX2, "avx2"}};
+
+//! Sizes that matter: a TCP header, a small segment, a full Ethernet payload, a GSO super-segment
+static const vector<size_t> SIZES = {20, 64, 1500, 65536};
+
+//! Where each measurement's last result goes, so that the loop cannot be optimized away
+static volatile uint16_t result_sink = 0;
+
+//! Checksum `len` bytes (starting one byte in, so that the loads are unaligned) until about `total` bytes
+//! have been summed; \returns GB/s
+static double throughput(const Kernel kernel, const string &data, const size_t len, const size_t total) {
+    const string_view view = string_view(data).substr(1, len);
+    const size_t rounds = max<size_t>(1, total / len);
+    uint16_t sink = 0;
+    const auto start = steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        InternetChecksum check{sink};
+        check.add(view, kernel);
+        sink = check.value();
+    }
+    const auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    result_sink = sink;
+    return static_cast<double>(rounds * len) / elapsed / 1e9;
+}
+
+//! Copy `len` bytes out of `data` and checksum them, either in one fused pass or with memcpy() and then
+//! add() (which reads the bytes a second time), until about `total` bytes have been copied; \returns GB/s
+static double copy_throughput(const bool fused, const string &data, const size_t len, const size_t total) {
+    const string_view view = string_view(data).substr(1, len);
+    string dest(len, '\0');
+    const size_t rounds = max<size_t>(1, total / len);
+    uint16_t sink = 0;
+    const auto start = steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        InternetChecksum check{sink};
+        if (fused) {
+            check.copy_and_add(dest.data(), view);
+        } else {
+            memcpy(dest.data(), view.data(), view.size());
+            check.add(dest);
+        }
+        sink = check.value();
+    }
+    const auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    result_sink = sink;
+    return static_cast<double>(rounds * len) / elapsed / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        const size_t total = argc > 1 ? stoul(argv[1]) : size_t{1} << 30;
+
+        auto rd = get_random_generator();
+        string data(SIZES.back() + 1, '\0');
+        for (auto &ch : data) {
+            ch = static_cast<char>(rd());
+        }
+
+        cout << "InternetChecksum throughput (GB/s), " << total << " bytes per measurement; best kernel is "
+             << KERNELS.at(static_cast<size_t>(InternetChecksum::best_kernel())).second << "\n\n";
+        cout << left << setw(10) << "kernel" << right;
+        for (const size_t size : SIZES) {
+            cout << setw(10) << to_string(size) + " B";
+        }
+        cout << "\n" << fixed << setprecision(2);
+
+        for (const auto &[kernel, name] : KERNELS) {
+            if (not InternetChecksum::kernel_supported(kernel)) {
+                cout << left << setw(10) << name << right << "  (not supported by this CPU)\n";
+                continue;
+            }
+            cout << left << setw(10) << name << right;
+            for (const size_t size : SIZES) {
+                cout << setw(10) << throughput(kernel, data, size, total);
+            }
+            cout << "\n";
+        }
+
+        cout << "\nCopy and checksum with the best kernel (GB/s)\n\n";
+        for (const bool fused : {false, true}) {
+            cout << left << setw(10) << (fused ? "fused" : "separate") << right;
+            for (const size_t size : SIZES) {
+                cout << setw(10) << copy_throughput(fused, data, size, total);
+            }
+            cout << "\n";
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
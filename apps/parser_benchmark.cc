@@ -0,0 +1,180 @@
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "tcp_header.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+//! Classic pcap file layout: a 24-byte file header, then a 16-byte header before each packet
+static constexpr size_t PCAP_FILE_HEADER_LEN = 24;
+static constexpr size_t PCAP_RECORD_HEADER_LEN = 16;
+static constexpr uint32_t PCAP_MAGIC_USEC = 0xa1b2c3d4;
+static constexpr uint32_t PCAP_MAGIC_NSEC = 0xa1b23c4d;
+static constexpr uint32_t LINKTYPE_ETHERNET = 1;
+static constexpr size_t ETHERNET_HEADER_LEN = 14;
+static constexpr uint8_t PROTO_TCP = 6;
+
+//! Where each measurement's result goes, so that the loop cannot be optimized away
+static volatile uint64_t result_sink = 0;
+
+static uint32_t load_u32(const string &s, const size_t offset) {
+    uint32_t val;
+    memcpy(&val, s.data() + offset, sizeof(val));
+    return val;
+}
+
+//! The IPv4 datagrams in an Ethernet capture (written in this machine's byte order), without their framing
+static vector<Buffer> read_capture(const string &path) {
+    ifstream file{path, ios::binary};
+    const string data{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+    if (data.size() < PCAP_FILE_HEADER_LEN or
+        (load_u32(data, 0) != PCAP_MAGIC_USEC and load_u32(data, 0) != PCAP_MAGIC_NSEC)) {
+        throw runtime_error(path + ": not a pcap file in this machine's byte order");
+    }
+    if (load_u32(data, 20) != LINKTYPE_ETHERNET) {
+        throw runtime_error(path + ": not an Ethernet capture");
+    }
+
+    vector<Buffer> datagrams;
+    size_t pos = PCAP_FILE_HEADER_LEN;
+    while (pos + PCAP_RECORD_HEADER_LEN <= data.size()) {
+        const size_t caplen = load_u32(data, pos + 8);
+        pos += PCAP_RECORD_HEADER_LEN;
+        if (pos + caplen > data.size()) {
+            break;
+        }
+        if (caplen > ETHERNET_HEADER_LEN) {
+            datagrams.emplace_back(data.substr(pos + ETHERNET_HEADER_LEN, caplen - ETHERNET_HEADER_LEN));
+        }
+        pos += caplen;
+    }
+    return datagrams;
+}
+
+//! The IPv4 and TCP headers' fixed fields, read one at a time (each read checks the length and
+//! advances the Buffer), as the headers' parse() did; \returns a digest of the fields
+static uint64_t fixed_fields_per_field(const Buffer &datagram) {
+    NetParser p{datagram};
+    const uint8_t first_byte = p.u8();  // version and header length
+    uint64_t digest = first_byte;
+    digest += p.u8();   // type of service
+    digest += p.u16();  // length
+    digest += p.u16();  // id
+    digest += p.u16();  // flags and offset
+    digest += p.u8();   // ttl
+    const uint8_t proto = p.u8();
+    digest += proto;
+    digest += p.u16();  // checksum
+    digest += p.u32();  // source address
+    digest += p.u32();  // destination address
+    p.remove_prefix(4 * (first_byte & 0x0f) - IPv4Header::LENGTH);
+    if (proto == PROTO_TCP) {
+        digest += p.u16();  // source port
+        digest += p.u16();  // destination port
+        digest += p.u32();  // sequence number
+        digest += p.u32();  // ack number
+        digest += p.u8();   // data offset
+        digest += p.u8();   // flags
+        digest += p.u16();  // window size
+        digest += p.u16();  // checksum
+        digest += p.u16();  // urgent pointer
+    }
+    return p.error() ? 0 : digest;
+}
+
+//! The same fields, with one length check per header; \returns the same digest
+static uint64_t fixed_fields_bulk(const Buffer &datagram) {
+    NetParser p{datagram};
+    const optional<NetFields> ip = p.fixed(IPv4Header::LENGTH);
+    if (not ip) {
+        return 0;
+    }
+    const uint8_t hlen = ip->u8(0) & 0x0f;
+    uint64_t digest = uint64_t{ip->u8(0)} + ip->u8(1) + ip->u16(2) + ip->u16(4) + ip->u16(6) + ip->u8(8) + ip->u8(9) +
+                      ip->u16(10) + ip->u32(12) + ip->u32(16);
+    p.remove_prefix(4 * hlen - IPv4Header::LENGTH);
+    if (ip->u8(9) == PROTO_TCP) {
+        const optional<NetFields> tcp = p.fixed(TCPHeader::LENGTH);
+        if (not tcp) {
+            return 0;
+        }
+        digest += uint64_t{tcp->u16(0)} + tcp->u16(2) + tcp->u32(4) + tcp->u32(8) + tcp->u8(12) + tcp->u8(13) +
+                  tcp->u16(14) + tcp->u16(16) + tcp->u16(18);
+    }
+    return p.error() ? 0 : digest;
+}
+
+//! Both headers, options and IPv4 checksum included, as an InternetDatagram would parse them
+static uint64_t full_headers(const Buffer &datagram) {
+    NetParser p{datagram};
+    IPv4Header ip;
+    if (ip.parse(p) != ParseResult::NoError or ip.proto != PROTO_TCP) {
+        return 0;
+    }
+    TCPHeader tcp;
+    return tcp.parse(p) == ParseResult::NoError ? tcp.seqno.raw_value() : 0;
+}
+
+//! Run `parse` over the datagrams until about `total` have been parsed; \returns ns per datagram
+template <typename Parse>
+static double ns_per_datagram(const vector<Buffer> &datagrams, const size_t total, Parse &&parse) {
+    const size_t rounds = max<size_t>(1, total / datagrams.size());
+    uint64_t sink = 0;
+    const auto start = steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (const Buffer &datagram : datagrams) {
+            sink += parse(datagram);
+        }
+    }
+    const auto elapsed = duration_cast<duration<double, nano>>(steady_clock::now() - start).count();
+    result_sink = sink;
+    return elapsed / static_cast<double>(rounds * datagrams.size());
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        if (argc < 2) {
+            cerr << "Usage: " << argv[0] << " CAPTURE [DATAGRAMS]\n"
+                 << "\tCAPTURE\tan Ethernet pcap file, e.g. tests/ipv4_parser.data\n";
+            return EXIT_FAILURE;
+        }
+        const vector<Buffer> datagrams = read_capture(argv[1]);
+        if (datagrams.empty()) {
+            throw runtime_error("no datagrams in the capture");
+        }
+        const size_t total = argc > 2 ? stoul(argv[2]) : 10'000'000;
+
+        for (const Buffer &datagram : datagrams) {
+            if (fixed_fields_per_field(datagram) != fixed_fields_bulk(datagram)) {
+                throw runtime_error("bulk loads disagree with per-field parsing");
+            }
+        }
+
+        cout << "Header parsing, " << datagrams.size() << " datagrams, " << total
+             << " parsed per measurement (ns per datagram)\n\n"
+             << fixed << setprecision(1);
+        cout << left << setw(44) << "fixed fields, per-field u8/u16/u32" << right << setw(8)
+             << ns_per_datagram(datagrams, total, fixed_fields_per_field) << "\n";
+        cout << left << setw(44) << "fixed fields, bulk (NetParser::fixed)" << right << setw(8)
+             << ns_per_datagram(datagrams, total, fixed_fields_bulk) << "\n";
+        cout << left << setw(44) << "IPv4Header::parse + TCPHeader::parse" << right << setw(8)
+             << ns_per_datagram(datagrams, total, full_headers) << "\n";
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
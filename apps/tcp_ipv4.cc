@@ -34,8 +34,14 @@ static void show_usage(const char *argv0, const char *msg) {
 
          << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
 
+         << "   -g              Send super-segments, split to MSS on the wire   (off)\n\n"
+
+         << "   -e              Use Explicit Congestion Notification            (off)\n\n"
+
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
-         << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
+         << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n"
+         << "   -Cu <rate>      Mark uplink ECN-capable segments CE at <rate>   (no marks)\n"
+         << "   -Cd <rate>      Mark downlink ECN-capable segments CE at <rate> (no marks)\n\n"
 
          << "   -h              Show this message.\n\n";
 
@@ -93,6 +99,14 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
             tundev = argv[curr + 1];
             curr += 2;
 
+        } else if (strncmp("-g", argv[curr], 3) == 0) {
+            c_fsm.gso = true;
+            curr += 1;
+
+        } else if (strncmp("-e", argv[curr], 3) == 0) {
+            c_fsm.ecn = true;
+            curr += 1;
+
         } else if (strncmp("-Lu", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -Lu requires one argument.");
             float lossrate = strtof(argv[curr + 1], nullptr);
@@ -109,6 +123,20 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
                 static_cast<LossRateDnT>(static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-Cu", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -Cu requires one argument.");
+            float cerate = strtof(argv[curr + 1], nullptr);
+            using CeRateUpT = decltype(c_filt.ce_rate_up);
+            c_filt.ce_rate_up = static_cast<CeRateUpT>(static_cast<float>(numeric_limits<CeRateUpT>::max()) * cerate);
+            curr += 2;
+
+        } else if (strncmp("-Cd", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -Cd requires one argument.");
+            float cerate = strtof(argv[curr + 1], nullptr);
+            using CeRateDnT = decltype(c_filt.ce_rate_dn);
+            c_filt.ce_rate_dn = static_cast<CeRateDnT>(static_cast<float>(numeric_limits<CeRateDnT>::max()) * cerate);
+            curr += 2;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -0,0 +1,247 @@
+#include "stream_reassembler.hh"
+#include "tcp_connection.hh"
+#include "tcp_listener.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Every heap allocation in the process goes through these, so the footprint of a connection is
+// the change in `heap_bytes` while it is built up (counting what malloc really hands out).
+static size_t heap_bytes = 0;
+
+void *operator new(size_t size) {
+    void *ptr = malloc(size);
+    if (ptr == nullptr) {
+        throw bad_alloc();
+    }
+    heap_bytes += malloc_usable_size(ptr);
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    if (ptr != nullptr) {
+        heap_bytes -= malloc_usable_size(ptr);
+        free(ptr);
+    }
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+static constexpr size_t FOOTPRINT_TARGET = 1024;
+
+static TCPSegment make_segment(const WrappingInt32 seqno, const WrappingInt32 ackno, const string &payload = {}) {
+    TCPSegment seg;
+    seg.header().seqno = seqno;
+    seg.header().ack = true;
+    seg.header().ackno = ackno;
+    seg.header().win = 64000;
+    if (not payload.empty()) {
+        seg.set_payload(Buffer(string(payload)));
+    }
+    return seg;
+}
+
+// The three stream buffers: the outbound ByteStream, and the reassembler's buffer and ByteStream.
+static size_t stream_buffer_bytes(const TCPConfig &cfg) {
+    const size_t before = heap_bytes;
+    const ByteStream outbound{cfg.send_capacity};
+    const StreamReassembler inbound{cfg.recv_capacity};
+    return heap_bytes - before;
+}
+
+static void drain(TCPConnection &conn) {
+    while (not conn.segments_out().empty()) {
+        conn.segments_out().pop();
+    }
+}
+
+// Drive one connection through its life with hand-made peer segments (so that no other connection's
+// allocations are counted), and report its static and heap bytes at each step.
+static void footprint_report() {
+    const TCPConfig cfg;
+
+    const size_t buffer_bytes = stream_buffer_bytes(cfg);
+
+    cout << "sizeof: TCPConnection " << sizeof(TCPConnection) << ", TCPSender " << sizeof(TCPSender)
+         << ", TCPReceiver " << sizeof(TCPReceiver) << ", ByteStream " << sizeof(ByteStream)
+         << ", StreamReassembler " << sizeof(StreamReassembler) << ", TCPSegment " << sizeof(TCPSegment) << "\n";
+    cout << "stream buffers (" << cfg.send_capacity << " B out, " << cfg.recv_capacity << " B in): " << buffer_bytes
+         << " B of heap\n\n";
+
+    cout << left << setw(34) << "state" << right << setw(8) << "static" << setw(10) << "heap" << setw(12)
+         << "in flight" << setw(12) << "non-buffer" << "\n";
+
+    const size_t base = heap_bytes;
+    TCPConnection conn{cfg};
+    size_t payload_in_flight = 0;
+    auto report = [&](const string &what) {
+        const size_t heap = heap_bytes - base;
+        const size_t state = sizeof(TCPConnection) + heap - buffer_bytes - payload_in_flight;
+        cout << left << setw(34) << what << right << setw(8)
+             << sizeof(TCPConnection) << setw(10) << heap << setw(12) << payload_in_flight << setw(12) << state
+             << (state < FOOTPRINT_TARGET ? "" : "  over target") << "\n";
+    };
+    report("CLOSED (fresh)");
+
+    conn.connect();
+    const WrappingInt32 isn = conn.segments_out().front().header().seqno;
+    drain(conn);
+    report("SYN_SENT");
+
+    const WrappingInt32 peer_isn{0x10000};
+    TCPSegment syn_ack = make_segment(peer_isn, isn + 1);
+    syn_ack.header().syn = true;
+    conn.segment_received(syn_ack);
+    drain(conn);
+    report("ESTABLISHED, idle");
+
+    // Payload copies held for retransmission are data, not connection state; count them separately.
+    conn.write(string(10 * TCPConfig::MAX_PAYLOAD_SIZE, 'x'));
+    drain(conn);
+    payload_in_flight = conn.bytes_in_flight();
+    report("ESTABLISHED, 10 segments in flight");
+
+    const WrappingInt32 all_acked = isn + 1 + 10 * TCPConfig::MAX_PAYLOAD_SIZE;
+    conn.segment_received(make_segment(peer_isn + 1, all_acked));
+    drain(conn);
+    payload_in_flight = 0;
+    report("ESTABLISHED, burst acknowledged");
+
+    // The queues keep the burst's slots for the next one until the connection has been idle for a while.
+    conn.tick(TCPConnection::QUEUE_TRIM_IDLE_MS);
+    drain(conn);
+    report("ESTABLISHED, idle after the burst");
+
+    conn.segment_received(make_segment(peer_isn + 1001, all_acked, string(500, 'y')));
+    drain(conn);
+    report("ESTABLISHED, 500 B out of order");
+
+    conn.segment_received(make_segment(peer_isn + 1, all_acked, string(1000, 'y')));
+    conn.inbound_stream().read(1500);
+    drain(conn);
+    report("ESTABLISHED, hole filled and read");
+
+    conn.end_input_stream();
+    drain(conn);
+    TCPSegment fin = make_segment(peer_isn + 1501, all_acked + 1);
+    fin.header().fin = true;
+    conn.segment_received(fin);
+    drain(conn);
+    report("TIME_WAIT");
+    cout << "(non-buffer = static + heap - stream buffers - payload in flight; target < " << FOOTPRINT_TARGET
+         << " B)\n\n";
+}
+
+static constexpr uint32_t CLIENT_IP = 0x0a000002;
+static constexpr uint32_t SERVER_IP = 0x0a000001;
+static constexpr uint16_t SERVER_PORT = 80;
+
+static FourTuple reversed(const FourTuple &t) { return {t.remote_ip, t.remote_port, t.local_ip, t.local_port}; }
+
+static void exchange(TCPMultiplexer &client, TCPListener &server) {
+    while (not client.segments_out().empty() or not server.segments_out().empty()) {
+        while (not client.segments_out().empty()) {
+            auto &tagged = client.segments_out().front();
+            server.segment_received(reversed(tagged.first), tagged.second);
+            client.segments_out().pop();
+        }
+        while (not server.segments_out().empty()) {
+            auto &tagged = server.segments_out().front();
+            client.segment_received(reversed(tagged.first), tagged.second);
+            server.segments_out().pop();
+        }
+    }
+}
+
+static double seconds_since(const high_resolution_clock::time_point start) {
+    return duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+}
+
+// Open `n` connections through a TCPListener, send a request on each, and close them all.
+static void scale_run(const size_t n) {
+    const TCPConfig cfg;
+    const size_t base = heap_bytes;
+    TCPMultiplexer client{cfg};
+    TCPListener server{cfg, n, n};
+
+    vector<FourTuple> tuples;
+    tuples.reserve(n);
+    const auto open_start = high_resolution_clock::now();
+    for (size_t i = 0; i < n; i++) {
+        const FourTuple tuple{CLIENT_IP, static_cast<uint16_t>(1024 + i), SERVER_IP, SERVER_PORT};
+        client.connect(tuple);
+        tuples.push_back(tuple);
+    }
+    exchange(client, server);
+    vector<FourTuple> accepted;
+    accepted.reserve(n);
+    for (auto tuple = server.accept(); tuple.has_value(); tuple = server.accept()) {
+        accepted.push_back(*tuple);
+    }
+    const double open_s = seconds_since(open_start);
+    if (accepted.size() != n) {
+        throw runtime_error("only " + to_string(accepted.size()) + " of " + to_string(n) + " connections accepted");
+    }
+    const size_t heap_per_connection = (heap_bytes - base) / (2 * n);
+    const size_t buffer_bytes = stream_buffer_bytes(cfg);
+
+    const string request(100, 'r');
+    const auto transfer_start = high_resolution_clock::now();
+    for (const auto &tuple : tuples) {
+        client.write(tuple, request);
+    }
+    exchange(client, server);
+    size_t received = 0;
+    for (const auto &tuple : accepted) {
+        TCPConnection *conn = server.connections().find(tuple);
+        received += conn->inbound_stream().read(conn->inbound_stream().buffer_size()).size();
+        server.connections().flush(tuple);
+    }
+    exchange(client, server);
+    const double transfer_s = seconds_since(transfer_start);
+    if (received != n * request.size()) {
+        throw runtime_error("received " + to_string(received) + " bytes, expected " + to_string(n * request.size()));
+    }
+
+    const auto close_start = high_resolution_clock::now();
+    for (const auto &tuple : tuples) {
+        client.end_input_stream(tuple);
+    }
+    for (const auto &tuple : accepted) {
+        server.connections().end_input_stream(tuple);
+    }
+    exchange(client, server);
+    while (client.size() > 0 or server.connections().size() > 0) {
+        client.tick(cfg.rt_timeout);
+        server.tick(cfg.rt_timeout);
+        exchange(client, server);
+    }
+    const double close_s = seconds_since(close_start);
+
+    cout << fixed << setprecision(0);
+    cout << n << " connections: " << n / open_s << " handshakes/s, " << n / transfer_s << " requests/s, "
+         << n / close_s << " closes/s\n";
+    cout << "heap per established connection (both ends, including the tables): " << heap_per_connection
+         << " B, of which " << heap_per_connection - buffer_bytes << " B outside the stream buffers\n";
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        footprint_report();
+        scale_run(argc > 1 ? stoul(argv[1]) : 2000);
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
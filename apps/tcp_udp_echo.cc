@@ -0,0 +1,103 @@
+#include "eventloop.hh"
+#include "fd_adapter.hh"
+#include "tcp_config.hh"
+#include "tcp_listener.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//! How long to wait for a datagram before letting time pass for the connections
+static constexpr int POLL_TIMEOUT_MS = 10;
+
+static void show_usage(const char *argv0) {
+    cerr << "Usage: " << argv0 << " [-c] <port>\n\n"
+         << "   Serve any number of clients (e.g. tcp_udp <host> <port>) over one UDP socket,\n"
+         << "   sending back every byte each connection sends.\n\n"
+         << "   -c              Answer SYNs with SYN cookies when the SYN queue is full\n\n";
+}
+
+//! An accepted connection, and whether its outbound stream has been ended
+struct Client {
+    FourTuple tuple;
+    bool outbound_ended;
+};
+
+//! Move what each connection received to its outbound stream; \returns `false` for connections that are gone
+static bool echo(TCPMultiplexer &connections, Client &client) {
+    TCPConnection *const connection = connections.find(client.tuple);
+    if (connection == nullptr) {
+        return false;
+    }
+    ByteStream &inbound = connection->inbound_stream();
+    const size_t len = min(inbound.buffer_size(), connection->remaining_outbound_capacity());
+    if (len > 0) {
+        connections.write(client.tuple, inbound.read(len));
+    }
+    if (inbound.eof() and not client.outbound_ended) {
+        connections.end_input_stream(client.tuple);
+        client.outbound_ended = true;
+    }
+    connections.flush(client.tuple);  // may drop a finished connection
+    return true;
+}
+
+int main(int argc, char **argv) {
+    try {
+        if (argc < 2 or argc > 3 or (argc == 3 and strcmp(argv[1], "-c") != 0)) {
+            show_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        const Address local{"0", argv[argc - 1]};
+
+        UDPSocket sock;
+        sock.bind(local);
+        TCPOverUDPSocketAdapter adapter{move(sock)};
+        adapter.config_mut().source = local;
+
+        TCPListener listener{TCPConfig{}};
+        listener.set_syn_cookies(argc == 3);
+        vector<Client> clients;
+
+        EventLoop loop;
+        loop.add_rule(adapter, Direction::In, [&] {
+            auto received = adapter.read_any();
+            if (received.has_value()) {
+                listener.segment_received(received->first, received->second);
+            }
+        });
+
+        uint64_t last_tick = timestamp_ms();
+        while (loop.wait_next_event(POLL_TIMEOUT_MS) != EventLoop::Result::Exit) {
+            const uint64_t now = timestamp_ms();
+            listener.tick(now - last_tick);
+            last_tick = now;
+
+            while (const auto tuple = listener.accept()) {
+                clients.push_back({*tuple, false});
+            }
+            for (auto it = clients.begin(); it != clients.end();) {
+                it = echo(listener.connections(), *it) ? next(it) : clients.erase(it);
+            }
+
+            auto &out = listener.segments_out();
+            while (not out.empty()) {
+                adapter.write_to(out.front().first, out.front().second);
+                out.pop();
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
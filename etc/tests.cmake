@@ -21,6 +21,22 @@ add_test(NAME t_send_window          COMMAND send_window)
 add_test(NAME t_send_ack             COMMAND send_ack)
 add_test(NAME t_send_close           COMMAND send_close)
 add_test(NAME t_send_extra           COMMAND send_extra)
+add_test(NAME t_send_rack            COMMAND send_rack)
+add_test(NAME t_send_persist         COMMAND send_persist)
+
+add_test(NAME t_segment_split        COMMAND tcp_segment_split)
+add_test(NAME t_tcp_options          COMMAND tcp_options)
+add_test(NAME t_checksum             COMMAND checksum)
+add_test(NAME t_headroom             COMMAND headroom)
+add_test(NAME t_ack_template         COMMAND ack_template)
+add_test(NAME t_tcp_over_ip          COMMAND tcp_over_ip)
+add_test(NAME t_timing_wheel         COMMAND timing_wheel)
+add_test(NAME t_ring_queue           COMMAND ring_queue)
+add_test(NAME t_connection_table     COMMAND connection_table)
+add_test(NAME t_tcp_multiplexer      COMMAND tcp_multiplexer)
+add_test(NAME t_tcp_listener         COMMAND tcp_listener)
+add_test(NAME t_syn_cookies          COMMAND syn_cookies)
+add_test(NAME t_fastopen             COMMAND fastopen)
 
 add_test(NAME t_strm_reassem_single      COMMAND fsm_stream_reassembler_single)
 add_test(NAME t_strm_reassem_seq         COMMAND fsm_stream_reassembler_seq)
@@ -56,6 +72,13 @@ add_test(NAME t_connect              COMMAND fsm_connect_relaxed)
 add_test(NAME ec_listen              COMMAND fsm_listen)
 add_test(NAME t_listen               COMMAND fsm_listen_relaxed)
 add_test(NAME t_winsize              COMMAND fsm_winsize)
+add_test(NAME t_timestamps           COMMAND fsm_timestamps)
+add_test(NAME t_deadline             COMMAND fsm_deadline)
+add_test(NAME t_batch                COMMAND fsm_batch)
+add_test(NAME t_keepalive            COMMAND fsm_keepalive)
+add_test(NAME t_window_update        COMMAND fsm_window_update)
+add_test(NAME t_ecn                  COMMAND fsm_ecn)
+add_test(NAME t_stats                COMMAND fsm_stats)
 add_test(NAME ec_retx                COMMAND fsm_retx)
 add_test(NAME t_retx                 COMMAND fsm_retx_relaxed)
 add_test(NAME t_retx_win             COMMAND fsm_retx_win)
@@ -1,5 +1,7 @@
 #include "byte_stream.hh"
 
+#include "util.hh"
+
 #include <cassert>
 #include <cstring>
 
@@ -59,6 +61,19 @@ std::string ByteStream::read(const size_t len) {
     return ret;
 }
 
+//! The one or two contiguous pieces of the ring buffer are summed in the same pass that copies them,
+//! so a sender gets its payload's checksum without reading the payload again.
+std::string ByteStream::read(const size_t len, InternetChecksum &check) {
+    size_t read_size = std::min(len, used_size_);
+    std::string ret;
+    ret.resize(read_size);
+    size_t copy1 = std::min(read_size, buffer_.capacity() - start_pos_);
+    check.copy_and_add(ret.data(), std::string_view(buffer_.data() + start_pos_, copy1));
+    check.copy_and_add(ret.data() + copy1, std::string_view(buffer_.data(), read_size - copy1));
+    pop_output(read_size);
+    return ret;
+}
+
 void ByteStream::end_input() {
     input_ended_ = true;
 }
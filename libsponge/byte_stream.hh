@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 
+class InternetChecksum;
+
 //! \brief An in-order byte stream.
 
 //! Bytes are written on the "input" side and read from the "output"
@@ -55,6 +57,10 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read the next "len" bytes of the stream, adding them to `check` as they are copied out
+    //! \returns a string
+    std::string read(const size_t len, InternetChecksum &check);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
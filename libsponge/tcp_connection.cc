@@ -1,6 +1,8 @@
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 size_t TCPConnection::remaining_outbound_capacity() const {
     return sender_.stream_in().remaining_capacity();
@@ -12,25 +14,152 @@ size_t TCPConnection::unassembled_bytes() const { return receiver_.unassembled_b
 
 size_t TCPConnection::time_since_last_segment_received() const { return ms_since_last_recv_; }
 
+TCPConnectionStats TCPConnection::stats() const {
+    TCPConnectionStats stats{};
+    stats.state = state().official_state();
+    stats.bytes_acked = sender_.bytes_acked();
+    stats.bytes_received = receiver_.stream_out().bytes_written();
+    stats.bytes_retransmitted = sender_.retransmitted_bytes();
+    stats.segments_in = counters_.segments_in;
+    stats.segments_out = counters_.segments_out;
+    stats.segments_retransmitted = sender_.retransmitted_segments();
+    stats.dup_acks = sender_.dup_acks();
+    stats.srtt_ms = sender_.rtt_estimator().srtt_ms();
+    stats.rto_ms = sender_.rto_ms();
+    stats.cwnd = sender_.congestion_window();
+    stats.peer_window = sender_.peer_window();
+    stats.bytes_in_flight = sender_.bytes_in_flight();
+    stats.unassembled_bytes = receiver_.unassembled_bytes();
+    stats.app_limited_ms = counters_.limited_ms[static_cast<size_t>(TCPSender::Limit::kApp)];
+    stats.rwnd_limited_ms = counters_.limited_ms[static_cast<size_t>(TCPSender::Limit::kRwnd)];
+    stats.cwnd_limited_ms = counters_.limited_ms[static_cast<size_t>(TCPSender::Limit::kCwnd)];
+    stats.sndbuf_limited_ms = counters_.limited_ms[static_cast<size_t>(TCPSender::Limit::kSndbuf)];
+    return stats;
+}
+
+std::optional<size_t> TCPConnection::time_until_next_deadline() const {
+    if (!active_) {
+        return std::nullopt;
+    }
+    std::optional<size_t> deadline = sender_.time_until_next_deadline();
+    if (lingering()) {
+        const size_t linger_ms = 10 * cfg_.rt_timeout;
+        const size_t remaining = ms_since_last_recv_ >= linger_ms ? 0 : linger_ms - ms_since_last_recv_;
+        deadline = std::min(remaining, deadline.value_or(remaining));
+    }
+    if (const std::optional<size_t> due = keepalive_due()) {
+        const size_t remaining = ms_since_last_recv_ >= due.value() ? 0 : due.value() - ms_since_last_recv_;
+        deadline = std::min(remaining, deadline.value_or(remaining));
+    }
+    if (queues_oversized()) {
+        const size_t remaining =
+            ms_since_last_recv_ >= QUEUE_TRIM_IDLE_MS ? 0 : QUEUE_TRIM_IDLE_MS - ms_since_last_recv_;
+        deadline = std::min(remaining, deadline.value_or(remaining));
+    }
+    return deadline;
+}
+
+std::optional<size_t> TCPConnection::keepalive_due() const {
+    // Only an established connection with nothing in flight probes; otherwise the RTO is watching the peer.
+    if (cfg_.keepalive_idle_ms == 0 || !handshake_complete() || lingering() || sender_.bytes_in_flight() > 0) {
+        return std::nullopt;
+    }
+    return size_t{cfg_.keepalive_idle_ms} + size_t{keepalive_probes_sent_} * cfg_.keepalive_interval_ms;
+}
+
+void TCPConnection::tick_keepalive() {
+    const std::optional<size_t> due = keepalive_due();
+    if (!due.has_value() || ms_since_last_recv_ < due.value()) {
+        return;
+    }
+    if (keepalive_probes_sent_ >= cfg_.keepalive_probes) {
+        // The peer has stopped answering: give up, as when retransmissions run out.
+        send_rst();
+        return;
+    }
+    sender_.send_keepalive_probe();
+    keepalive_probes_sent_++;
+}
+
+bool TCPConnection::lingering() const {
+    return linger_after_stream_finish_ && receiver_.state() == TCPReceiver::State::kFinRecv;
+}
+
 void TCPConnection::enqueue_segments() {
     while (!sender_.segments_out().empty()) {
-        TCPSegment seg = std::move(sender_.segments_out().front());
+        // Rewrite the header in the sender's slot, then move it over; the payload is never copied.
+        TCPSegment &seg = sender_.segments_out().front();
         if (need_send_rst_) {
             seg.header().rst = true;
-            segments_out_.emplace(seg);
+            segments_out_.push(std::move(seg));
+            counters_.segments_out++;
+            sender_.segments_out().pop();
             return;
         }
         // Before sending, we will ask the receiver for the ack no and window size.
+        // The window goes on our SYN too, for a Fast Open server that answers before the handshake completes.
+        seg.header().win = advertised_window();
         if (receiver_.ackno()) {
             seg.header().ack = true;
             seg.header().ackno = receiver_.ackno().value();
-            seg.header().win = static_cast<uint16_t>(std::min(
-                receiver_.window_size(),
-                static_cast<size_t>(std::numeric_limits<uint16_t>::max())
-            ));
+            advertised_right_edge_ = seg.header().ackno + seg.header().win;
         }
-        segments_out_.emplace(seg);
+        if (cfg_.announce_mss && seg.header().syn) {
+            seg.header().mss = TCPConfig::MAX_PAYLOAD_SIZE;
+        }
+        // Our SYN presents the cookie (or asks for one); our SYN/ACK issues one if the client needs it.
+        if (cfg_.fastopen && seg.header().syn && (!receiver_.ackno() || fastopen_send_cookie_)) {
+            seg.header().fastopen = fastopen_cookie_;
+        }
+        if (cfg_.ecn && seg.header().syn) {
+            seg.header().ece = !receiver_.ackno() || ecn_ok_;
+            seg.header().cwr = !receiver_.ackno();
+        } else if (ece_pending_) {
+            seg.header().ece = true;
+        }
+        // Timestamps are offered on our SYN, and used on everything once both sides agreed.
+        if (timestamps_ok_ || (cfg_.timestamps && seg.header().syn && !receiver_.ackno())) {
+            seg.header().ts = TCPHeader::Timestamps{sender_.ts_value(), receiver_.ts_recent().value_or(0)};
+        }
+        segments_out_.push(std::move(seg));
         sender_.segments_out().pop();
+        counters_.segments_out++;
+    }
+}
+
+size_t TCPConnection::window_update_threshold() const {
+    return std::max<size_t>(1, std::min(TCPConfig::MAX_PAYLOAD_SIZE, receiver_.capacity() / 2));
+}
+
+int32_t TCPConnection::window_growth() const {
+    const size_t window = std::min(receiver_.window_size(), static_cast<size_t>(std::numeric_limits<uint16_t>::max()));
+    return (receiver_.ackno().value() + static_cast<uint32_t>(window)) - advertised_right_edge_;
+}
+
+uint16_t TCPConnection::advertised_window() const {
+    const size_t window = std::min(receiver_.window_size(), static_cast<size_t>(std::numeric_limits<uint16_t>::max()));
+    if (!receiver_.ackno().has_value()) {
+        return static_cast<uint16_t>(window);
+    }
+    // Receiver-side silly window syndrome avoidance: every ACK, not only a window update, keeps the right
+    // edge where it was until it can move by a worthwhile amount.
+    const int32_t growth = window_growth();
+    if (growth > 0 && static_cast<size_t>(growth) >= window_update_threshold()) {
+        return static_cast<uint16_t>(window);
+    }
+    const int32_t held = advertised_right_edge_ - receiver_.ackno().value();
+    return static_cast<uint16_t>(std::clamp<int64_t>(held, 0, static_cast<int64_t>(window)));
+}
+
+void TCPConnection::inbound_stream_read() {
+    if (!active_ || receiver_.state() != TCPReceiver::State::kSynRecv) {
+        return;
+    }
+    // Only a worthwhile opening is announced; see advertised_window().
+    const int32_t growth = window_growth();
+    if (growth > 0 && static_cast<size_t>(growth) >= window_update_threshold()) {
+        sender_.send_empty_segment();
+        enqueue_segments();
     }
 }
 
@@ -38,15 +167,19 @@ void TCPConnection::try_clean_shutdown() {
     // The connection is closed when:
     // case 1: Active close, FIN_RECV, the lingering timer expired.
     // case 2: Passive close, FIN_ACKED.
-    if ((linger_after_stream_finish_ &&
-         receiver_.state() == TCPReceiver::State::kFinRecv &&
-         ms_since_last_recv_ >= 10 * cfg_.rt_timeout) ||
+    if ((lingering() && ms_since_last_recv_ >= 10 * cfg_.rt_timeout) ||
         (!linger_after_stream_finish_ &&
          sender_.state() == TCPSender::State::kFinAcked)) {
         active_ = false;
     }
 }
 
+void TCPConnection::send_rst() {
+    unclean_shutdown();
+    need_send_rst_ = true;
+    sender_.send_empty_segment();
+}
+
 void TCPConnection::unclean_shutdown() {
     receiver_.stream_out().set_error();
     sender_.stream_in().set_error();
@@ -54,26 +187,69 @@ void TCPConnection::unclean_shutdown() {
     active_ = false;
 }
 
-void TCPConnection::segment_received(const TCPSegment &seg) {
-    // The connection is LISTEN.
-    if (receiver_.state() == TCPReceiver::State::kListen &&
-        sender_.state() == TCPSender::State::kClosed) {
-        // Non-SYN or ACKs or RSTs in LISTEN should be ignored.
-        if (!seg.header().syn || seg.header().ack || seg.header().rst) {
-            return;
-        }
-    }
+bool TCPConnection::ignored_in_listen(const TCPSegment &seg) const {
+    // Non-SYN or ACKs or RSTs in LISTEN should be ignored.
+    return receiver_.state() == TCPReceiver::State::kListen && sender_.state() == TCPSender::State::kClosed &&
+           (!seg.header().syn || seg.header().ack || seg.header().rst);
+}
+
+bool TCPConnection::process_segment(const TCPSegment &seg) {
+    counters_.segments_in++;
     ms_since_last_recv_ = 0;
+    keepalive_probes_sent_ = 0;
     // RST: set both the inbound/outbound streams to the error state and kill the connection.
     if (seg.header().rst) {
         unclean_shutdown();
-        return;
+        return false;
+    }
+    // The peer's SYN decides whether timestamps are in use for the rest of the connection,
+    // and how large our segments may be (super-segments are split to size by the adapter).
+    bool accept_syn_data = true;
+    if (seg.header().syn) {
+        timestamps_ok_ = cfg_.timestamps && seg.header().ts.has_value();
+        if (seg.header().mss.has_value() && !cfg_.gso) {
+            sender_.limit_payload_size(seg.header().mss.value());
+        }
+        if (cfg_.fastopen) {
+            accept_syn_data = fastopen_syn_received(seg);
+        }
+        // An ECN-setup SYN has ECE and CWR; an ECN-setup SYN/ACK only ECE (RFC 3168 section 6.1.1).
+        if (cfg_.ecn) {
+            ecn_ok_ = seg.header().ece && seg.header().cwr != seg.header().ack;
+            if (ecn_ok_) {
+                sender_.enable_ecn();
+            }
+        }
+    } else if (ecn_ok_) {
+        // A CE mark is echoed until the peer's CWR shows that it has reacted.
+        if (seg.header().cwr) {
+            ece_pending_ = false;
+        }
+        if (seg.ecn() == TCPSegment::ECN_CE) {
+            ece_pending_ = true;
+        }
+    }
+    // PAWS: an old duplicate is only acknowledged, never processed.
+    if (timestamps_ok_ && receiver_.paws_reject(seg)) {
+        return true;
     }
     // Give the segment to the receiver.
-    receiver_.segment_received(seg);
+    const bool syn_was_received = receiver_.ackno().has_value();
+    receiver_.segment_received(seg, accept_syn_data);
+    if (!syn_was_received && receiver_.ackno().has_value()) {
+        // Nothing advertised yet: the whole window is an opening.
+        advertised_right_edge_ = receiver_.ackno().value();
+    }
     // ACK: tell the sender about the fields it cares about.
     if (seg.header().ack) {
-        sender_.ack_received(seg.header().ackno, seg.header().win);
+        std::optional<uint32_t> ts_ecr{};
+        if (timestamps_ok_ && seg.header().ts.has_value()) {
+            ts_ecr = seg.header().ts->ecr;
+        }
+        sender_.ack_received(seg.header().ackno, seg.header().win, ts_ecr);
+        if (ecn_ok_ && seg.header().ece && !seg.header().syn) {
+            sender_.ecn_echo_received();
+        }
     }
     // If read end is closed and write end is not closed, it is the passive close case.
     if (receiver_.state() == TCPReceiver::State::kFinRecv &&
@@ -81,23 +257,110 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
         linger_after_stream_finish_ = false;
         try_clean_shutdown();
     }
-    // Try to send some segments.
-    sender_.fill_window();
-    // Maybe need to send empty segment to reply.
-    size_t segment_length = seg.length_in_sequence_space();
     // case 1: If the incoming segment occupied any seq no, we need to send at least one segment in reply,
     //         to reflect an update in the ack no and window size.
     // case 2: The peer may send a segment with an invalid seq no for keep-alive.
     //         We should reply even though the segment does not occupy any seq no.
-    if (segment_length > 0 ||
-        (receiver_.state() == TCPReceiver::State::kSynRecv &&
-         seg.header().seqno == receiver_.ackno().value() - 1)) {
+    return seg.length_in_sequence_space() > 0 ||
+           (receiver_.state() == TCPReceiver::State::kSynRecv &&
+            seg.header().seqno == receiver_.ackno().value() - 1);
+}
+
+bool TCPConnection::fastopen_syn_received(const TCPSegment &seg) {
+    const std::optional<TCPHeader::FastOpenCookie> &option = seg.header().fastopen;
+    if (seg.header().ack) {
+        // The server's SYN/ACK: keep a newly issued cookie for the next connection.
+        if (option.has_value() && !option->empty() && option.value() != fastopen_cookie_) {
+            fastopen_cookie_ = option.value();
+            fastopen_cookie_issued_ = true;
+        }
+        return true;
+    }
+    // A client's SYN: its data is only taken with the right cookie (RFC 7413 section 4.2.2).
+    const bool valid = option.has_value() && !fastopen_cookie_.empty() && option.value() == fastopen_cookie_;
+    fastopen_send_cookie_ = option.has_value() && !valid && !fastopen_cookie_.empty();
+    if (valid) {
+        // The client has proven its address, so the response need not wait for the handshake.
+        sender_.syn_window_received(seg.header().win);
+    }
+    return valid;
+}
+
+void TCPConnection::set_fastopen_cookie(const TCPHeader::FastOpenCookie &cookie) {
+    fastopen_cookie_ = cookie;
+    sender_.send_data_on_syn(cfg_.fastopen && !cookie.empty());
+}
+
+std::optional<TCPHeader::FastOpenCookie> TCPConnection::take_fastopen_cookie() {
+    if (!fastopen_cookie_issued_) {
+        return std::nullopt;
+    }
+    fastopen_cookie_issued_ = false;
+    return fastopen_cookie_;
+}
+
+bool TCPConnection::queues_oversized() const {
+    // Ours is only emptied once the owner has sent it.
+    return sender_.queues_oversized() ||
+           (segments_out_.empty() && segments_out_.capacity() > TCPSender::IDLE_QUEUE_SLOTS);
+}
+
+void TCPConnection::trim_queues() {
+    sender_.trim_queues();
+    if (segments_out_.empty() && segments_out_.capacity() > TCPSender::IDLE_QUEUE_SLOTS) {
+        segments_out_.shrink_to_fit();
+    }
+}
+
+void TCPConnection::respond(const bool need_ack) {
+    // Try to send some segments.
+    sender_.fill_window();
+    // Maybe need to send empty segment to reply; any data segment already carries the ACK.
+    if (need_ack) {
         sender_.send_empty_segment();
     }
     try_clean_shutdown();
     enqueue_segments();
 }
 
+void TCPConnection::segment_received(const TCPSegment &seg) {
+    if (ignored_in_listen(seg)) {
+        return;
+    }
+    const bool need_ack = process_segment(seg);
+    // After a RST there is nothing left to send.
+    if (seg.header().rst) {
+        return;
+    }
+    respond(need_ack);
+}
+
+void TCPConnection::segments_received(const std::vector<TCPSegment> &segs) {
+    bool processed = false;
+    bool need_ack = false;
+    for (const TCPSegment &seg : segs) {
+        if (ignored_in_listen(seg)) {
+            continue;
+        }
+        processed = true;
+        need_ack |= process_segment(seg);
+        // After a RST there is nothing left to do with the rest of the batch.
+        if (seg.header().rst) {
+            return;
+        }
+    }
+    if (processed) {
+        respond(need_ack);
+    }
+}
+
+bool TCPConnection::handshake_complete() const {
+    const TCPSender::State sender_state = sender_.state();
+    return active_ && receiver_.state() != TCPReceiver::State::kListen &&
+           sender_state != TCPSender::State::kClosed && sender_state != TCPSender::State::kSynSent &&
+           sender_state != TCPSender::State::kError;
+}
+
 bool TCPConnection::active() const {
     return active_;
 }
@@ -111,16 +374,26 @@ size_t TCPConnection::write(const std::string& data) {
 
 //! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
 void TCPConnection::tick(const size_t ms_since_last_tick) {
+    // The time since the last tick passed before whatever event preceded this one, so it goes to the
+    // limit in effect then, not to the one that event left behind.
+    if (handshake_complete()) {
+        counters_.limited_ms[static_cast<size_t>(limit_at_last_tick_)] += ms_since_last_tick;
+    }
     ms_since_last_recv_ += ms_since_last_tick;
     sender_.tick(ms_since_last_tick);
     if (sender_.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS) {
-        unclean_shutdown();
-        need_send_rst_ = true;
-        sender_.send_empty_segment();
+        send_rst();
     } else {
+        tick_keepalive();
         try_clean_shutdown();
     }
     enqueue_segments();
+    if (ms_since_last_recv_ >= QUEUE_TRIM_IDLE_MS) {
+        trim_queues();
+    }
+    if (handshake_complete()) {
+        limit_at_last_tick_ = sender_.limit();
+    }
 }
 
 void TCPConnection::end_input_stream() {
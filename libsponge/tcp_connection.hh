@@ -6,18 +6,68 @@
 #include "tcp_sender.hh"
 #include "tcp_state.hh"
 
+#include <array>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+//! \brief A snapshot of a connection's counters and estimates, in the spirit of Linux's TCP_INFO
+//! \details Plain data, so that it can be copied across threads and printed or logged as it is.
+struct TCPConnectionStats {
+    std::optional<TCPState::State> state{};  //!< The official state, if the connection is in one
+
+    uint64_t bytes_acked = 0;          //!< Payload bytes the peer has acknowledged
+    uint64_t bytes_received = 0;       //!< Payload bytes reassembled into the inbound stream
+    uint64_t bytes_retransmitted = 0;  //!< Payload bytes sent more than once
+    uint64_t segments_in = 0;          //!< Segments received
+    uint64_t segments_out = 0;         //!< Segments sent, including retransmissions
+    uint64_t segments_retransmitted = 0;
+    uint64_t dup_acks = 0;  //!< ACKs that acknowledged nothing new while data was in flight
+
+    uint64_t srtt_ms = 0;  //!< Smoothed RTT, or 0 before the first sample
+    uint64_t rto_ms = 0;   //!< Current retransmission timeout, including backoff
+    uint64_t cwnd = 0;     //!< Congestion window (TCPSender::UNLIMITED_CWND unless congestion was signalled)
+    uint64_t peer_window = 0;
+    uint64_t bytes_in_flight = 0;
+    uint64_t unassembled_bytes = 0;
+
+    //! \name Time since the handshake, by what kept the sender from sending more (TCPSender::Limit)
+    //!@{
+    uint64_t app_limited_ms = 0;
+    uint64_t rwnd_limited_ms = 0;
+    uint64_t cwnd_limited_ms = 0;
+    uint64_t sndbuf_limited_ms = 0;
+    //!@}
+};
+
+static_assert(std::is_trivially_copyable_v<TCPConnectionStats>);
+
 //! \brief A complete endpoint of a TCP connection
 class TCPConnection {
   private:
-    TCPConfig   cfg_;
-    TCPReceiver receiver_{cfg_.recv_capacity};
-    TCPSender   sender_{cfg_.send_capacity, cfg_.rt_timeout, cfg_.fixed_isn};
+    //! The parts of the TCPConfig still needed after construction (the rest sized the buffers).
+    struct Settings {
+        uint16_t rt_timeout;
+        bool timestamps;
+        bool gso;
+        bool announce_mss;
+        bool fastopen;
+        bool ecn;
+        uint8_t keepalive_probes;
+        uint32_t keepalive_idle_ms;
+        uint32_t keepalive_interval_ms;
+    };
+
+    TCPReceiver receiver_;
+    TCPSender   sender_;
 
     //! Number of milliseconds since the last segment was received.
     size_t ms_since_last_recv_ = 0;
 
     //! outbound queue of segments that the TCPConnection wants sent
-    std::queue<TCPSegment> segments_out_{};
+    RingQueue<TCPSegment> segments_out_{};
+
+    Settings cfg_;
 
     bool active_ = true;
 
@@ -28,15 +78,102 @@ class TCPConnection {
 
     bool need_send_rst_ = false;
 
+    //! Did both SYNs carry the Timestamps option? (only attempted when cfg_.timestamps is set)
+    bool timestamps_ok_ = false;
+
+    //! Right edge (ackno + win) of the window in the last ACK we sent (before the first, the ackno of the SYN).
+    WrappingInt32 advertised_right_edge_{0};
+
+    //! Did both SYNs negotiate ECN? (only attempted when cfg_.ecn is set)
+    bool ecn_ok_ = false;
+
+    //! Has a segment arrived marked CE, without a CWR from the peer since? Then our segments carry ECE.
+    bool ece_pending_ = false;
+
+    //! Keepalive probes sent since the last segment was received.
+    uint8_t keepalive_probes_sent_ = 0;
+
+    //! The sender's limit when the last tick() finished, which the time until the next tick is charged to.
+    TCPSender::Limit limit_at_last_tick_ = TCPSender::Limit::kApp;
+
+    //! The counters behind stats() that the sender and receiver don't keep.
+    struct Counters {
+        uint32_t segments_in = 0;
+        uint32_t segments_out = 0;
+        std::array<uint32_t, 4> limited_ms{};  //!< Indexed by TCPSender::Limit
+    };
+
+    Counters counters_{};
+
+    //! \name TCP Fast Open (only used when cfg_.fastopen is set)
+    //!@{
+
+    //! Actively opened: the server's cookie, to present on our SYN (a request if empty).
+    //! Passively opened: the cookie the client must present for its SYN data to be accepted.
+    TCPHeader::FastOpenCookie fastopen_cookie_{};
+
+    //! Did the server just issue the cookie in fastopen_cookie_? (see take_fastopen_cookie())
+    bool fastopen_cookie_issued_ = false;
+
+    //! Should our SYN/ACK give the client its cookie? (it asked, or presented a wrong one)
+    bool fastopen_send_cookie_ = false;
+    //!@}
+
   private:
     //! Get the outbound segments from sender and enqueue them into the |segments_out_|.
     void enqueue_segments();
 
+    //! The window to advertise: the receiver's, clamped to what the header can carry, unless that would
+    //! move the right edge by less than window_update_threshold(); then the edge stays where it was.
+    uint16_t advertised_window() const;
+
+    //! How far the advertised right edge must be able to move before it moves (RFC 1122 4.2.3.3).
+    size_t window_update_threshold() const;
+
+    //! How far the receiver's right edge has moved past the one last advertised.
+    int32_t window_growth() const;
+
     void try_clean_shutdown();
 
     void unclean_shutdown();
 
+    //! Shut down uncleanly and tell the peer with a RST.
+    void send_rst();
+
+    //! Should an incoming segment be dropped because the connection is in LISTEN?
+    bool ignored_in_listen(const TCPSegment &seg) const;
+
+    //! Apply one incoming segment to the receiver and sender.
+    //! \returns whether the segment calls for an ACK in reply
+    bool process_segment(const TCPSegment &seg);
+
+    //! Fill the window, add an ACK if one is owed, and queue everything for sending.
+    void respond(const bool need_ack);
+
+    //! Handle the TCP Fast Open option of a SYN or SYN/ACK.
+    //! \returns whether data on the segment may be accepted
+    bool fastopen_syn_received(const TCPSegment &seg);
+
+    //! Is any queue, with nothing in it, holding the storage of a past burst?
+    bool queues_oversized() const;
+
+    //! Free the queue storage that a past burst left behind; called from tick() once the connection is idle.
+    void trim_queues();
+
+    //! Is the connection lingering in TIME_WAIT (or CLOSING) until the linger timer expires?
+    bool lingering() const;
+
+    //! \returns the time since the last received segment at which the next keepalive probe
+    //! (or the reset, once every probe went unanswered) is due, or empty if keepalive does not apply
+    std::optional<size_t> keepalive_due() const;
+
+    //! Send a keepalive probe, or give up on the peer, if one is due.
+    void tick_keepalive();
+
   public:
+    //! Queues left oversized by a burst give their storage back once nothing has arrived for this long.
+    static constexpr size_t QUEUE_TRIM_IDLE_MS = 1000;
+
     //! \name "Input" interface for the writer
     //!@{
 
@@ -52,6 +189,16 @@ class TCPConnection {
 
     //! \brief Shut down the outbound byte stream (still allows reading incoming data)
     void end_input_stream();
+
+    //! \brief Set the TCP Fast Open cookie, before connecting or before the SYN arrives
+    //! \details A client gives the cookie it has for the server (from a FastOpenCache), if any: data
+    //! written before connect() (by calling write() instead) then goes out on the SYN. A server gives
+    //! the cookie for the client's address (from FastOpenCookies).
+    void set_fastopen_cookie(const TCPHeader::FastOpenCookie &cookie);
+
+    //! \brief A cookie that the server issued on its SYN/ACK, for the owner to cache
+    //! \returns the cookie once, then empty
+    std::optional<TCPHeader::FastOpenCookie> take_fastopen_cookie();
     //!@}
 
     //! \name "Output" interface for the reader
@@ -59,6 +206,12 @@ class TCPConnection {
 
     //! \brief The inbound byte stream received from the peer
     ByteStream& inbound_stream() { return receiver_.stream_out(); }
+
+    //! \brief Called after the application has read from inbound_stream()
+    //! \details Sends a window update if reading has moved the right edge of the window by at least
+    //! one MSS or half the receive buffer, whichever is smaller; smaller openings are left for the
+    //! next ACK to carry, so that the peer is not invited to send tiny segments (RFC 1122 4.2.3.3).
+    void inbound_stream_read();
     //!@}
 
     //! \name Accessors used for testing
@@ -70,6 +223,14 @@ class TCPConnection {
     size_t unassembled_bytes() const;
     //! \brief Number of milliseconds since the last segment was received
     size_t time_since_last_segment_received() const;
+    //! \brief Milliseconds until the next timer (retransmission, linger, keepalive, ...) needs tick()
+    //! \returns empty if nothing is scheduled, so tick() can wait for the next segment or write
+    std::optional<size_t> time_until_next_deadline() const;
+    //! \brief Has the three-way handshake completed (both SYNs sent and our SYN acknowledged)?
+    //! \note Much cheaper than state(), for callers that check it on every segment
+    bool handshake_complete() const;
+    //! \brief Counters and estimates of the connection, for debugging and monitoring
+    TCPConnectionStats stats() const;
     //!< \brief summarize the state of the sender, receiver, and the connection
     TCPState state() const { return {sender_, receiver_, active(), linger_after_stream_finish_}; };
     //!@}
@@ -80,6 +241,11 @@ class TCPConnection {
     //! Called when a new segment has been received from the network
     void segment_received(const TCPSegment &seg);
 
+    //! \brief Called with several segments received from the network at once
+    //! \details Each segment updates the receiver and sender in turn, but the window is
+    //! filled and the reply (at most one ACK, or data carrying it) is generated only once.
+    void segments_received(const std::vector<TCPSegment> &segs);
+
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
@@ -87,7 +253,7 @@ class TCPConnection {
     //! \note The owner or operating system will dequeue these and
     //! put each one into the payload of a lower-layer datagram (usually Internet datagrams (IP),
     //! but could also be user datagrams (UDP) or any other kind).
-    std::queue<TCPSegment>& segments_out() { return segments_out_; }
+    RingQueue<TCPSegment>& segments_out() { return segments_out_; }
 
     //! \brief Is the connection still alive in any way?
     //! \returns `true` if either stream is still running or if the TCPConnection is lingering
@@ -96,7 +262,18 @@ class TCPConnection {
     //!@}
 
     //! Construct a new connection from a configuration
-    explicit TCPConnection(const TCPConfig& cfg) : cfg_{cfg} {}
+    explicit TCPConnection(const TCPConfig& cfg)
+        : receiver_{cfg.recv_capacity}
+        , sender_{cfg}
+        , cfg_{cfg.rt_timeout,
+               cfg.timestamps,
+               cfg.gso,
+               cfg.announce_mss,
+               cfg.fastopen,
+               cfg.ecn,
+               cfg.keepalive_probes,
+               cfg.keepalive_idle_ms,
+               cfg.keepalive_interval_ms} {}
 
     //! \name construction and destruction
     //! moving is allowed; copying is disallowed; default construction not possible
@@ -0,0 +1,87 @@
+#include "ack_template.hh"
+
+#include "parser.hh"
+#include "tcp_over_ip.hh"
+
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+//! \name Where the fields that change sit in a serialized TCP header (the timestamps assume two NOPs before
+//! the option, as TCPHeader::serialize() writes it)
+//!@{
+static constexpr size_t SEQNO_OFFSET = 4;
+static constexpr size_t ACKNO_OFFSET = 8;
+static constexpr size_t FLAGS_OFFSET = 13;
+static constexpr size_t WIN_OFFSET = 14;
+static constexpr size_t CKSUM_OFFSET = 16;
+static constexpr size_t TSVAL_OFFSET = TCPHeader::LENGTH + 4;
+static constexpr size_t TSECR_OFFSET = TCPHeader::LENGTH + 8;
+//!@}
+
+//! Store `val` at `dest`; \returns its contribution to a ones'-complement sum
+static uint32_t put32(char *dest, const uint32_t val) {
+    NetUnparser::u32(dest, val);
+    return (val >> 16) + (val & 0xffff);
+}
+
+static uint32_t put16(char *dest, const uint16_t val) {
+    NetUnparser::u16(dest, val);
+    return val;
+}
+
+bool AckTemplate::fits(const TCPSegment &seg) {
+    const TCPHeader &header = seg.header();
+    return seg.payload().size() == 0 and seg.ecn() == TCPSegment::ECN_NOT_ECT and
+           header.doff == TCPHeader::LENGTH / 4 and header.uptr == 0 and not header.mss.has_value() and
+           not header.wscale.has_value() and not header.sack_permitted and header.sack.empty() and
+           not header.fastopen.has_value();
+}
+
+//! \details Each layout is serialized the ordinary way from a segment whose changing fields are zero; its
+//! checksum is then the complement of the sum of everything else.
+void AckTemplate::_build(const FourTuple &tuple) {
+    for (const bool timestamps : {false, true}) {
+        TCPSegment prototype;
+        if (timestamps) {
+            prototype.header().ts = TCPHeader::Timestamps{};
+        }
+        const string wire = TCPOverIPv4Adapter::serialize_tcp_in_ip(tuple, prototype).concatenate();
+
+        Layout &layout = timestamps ? _timestamps : _plain;
+        memcpy(layout.bytes.data(), wire.data(), wire.size());
+        layout.length = static_cast<uint8_t>(wire.size());
+        const optional<NetFields> tcp = NetParser{string(wire.substr(IPv4Header::LENGTH))}.fixed(TCPHeader::LENGTH);
+        layout.fixed_sum = static_cast<uint16_t>(~tcp->u16(CKSUM_OFFSET));
+    }
+    _tuple = tuple;
+}
+
+std::string_view AckTemplate::serialize(const FourTuple &tuple, TCPSegment &seg) {
+    if (_tuple != tuple) {
+        _build(tuple);
+    }
+    TCPHeader &header = seg.header();
+    header.sport = tuple.local_port;
+    header.dport = tuple.remote_port;
+
+    Layout &layout = header.ts.has_value() ? _timestamps : _plain;
+    char *const tcp = layout.bytes.data() + IPv4Header::LENGTH;
+    uint32_t sum = layout.fixed_sum;
+    sum += put32(tcp + SEQNO_OFFSET, header.seqno.raw_value());
+    sum += put32(tcp + ACKNO_OFFSET, header.ackno.raw_value());
+    NetUnparser::u8(tcp + FLAGS_OFFSET, header.flags());
+    sum += header.flags();  // the low byte of the word that starts with the data offset
+    sum += put16(tcp + WIN_OFFSET, header.win);
+    if (header.ts.has_value()) {
+        sum += put32(tcp + TSVAL_OFFSET, header.ts->val);
+        sum += put32(tcp + TSECR_OFFSET, header.ts->ecr);
+    }
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    NetUnparser::u16(tcp + CKSUM_OFFSET, static_cast<uint16_t>(~sum));
+
+    return {layout.bytes.data(), layout.length};
+}
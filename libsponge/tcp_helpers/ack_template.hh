@@ -0,0 +1,50 @@
+#ifndef SPONGE_LIBSPONGE_ACK_TEMPLATE_HH
+#define SPONGE_LIBSPONGE_ACK_TEMPLATE_HH
+
+#include "connection_table.hh"
+#include "ipv4_header.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+//! \brief A connection's pure ACKs, kept as a serialized IPv4 datagram and patched in place
+//! \details Most segments a receiver sends are bare ACKs that differ only in seqno, ackno, flags, window and
+//! (with timestamps) the timestamp values. The template holds such a datagram, addresses, ports and IPv4
+//! checksum included, together with the sum of the TCP checksum's unchanging part (pseudo-header too).
+//! Emitting an ACK stores the changing fields and folds them into that sum, instead of building the headers
+//! and summing them again.
+class AckTemplate {
+  public:
+    //! Whether `seg` can be sent from the template: no payload, no options but timestamps, no urgent
+    //! pointer, and not ECN-capable
+    static bool fits(const TCPSegment &seg);
+
+    //! \brief Serialize `seg`, which must fit(), in an IPv4 datagram for the connection `tuple`
+    //! \details Sets the segment's ports from `tuple`, as TCPOverIPv4Adapter::wrap_tcp_in_ip() does. The
+    //! template is rebuilt when `tuple` differs from the last one.
+    //! \returns the datagram, valid until the next call
+    std::string_view serialize(const FourTuple &tuple, TCPSegment &seg);
+
+  private:
+    //! Length of the longer layout: both headers and the (NOP-padded) Timestamps option
+    static constexpr size_t MAX_LENGTH = IPv4Header::LENGTH + TCPHeader::LENGTH + 2 + TCPHeader::TIMESTAMPS_LEN;
+
+    //! A serialized datagram, with its fields that change set to zero, and the TCP checksum's sum over it
+    struct Layout {
+        std::array<char, MAX_LENGTH> bytes{};
+        uint32_t fixed_sum = 0;
+        uint8_t length = 0;
+    };
+
+    void _build(const FourTuple &tuple);
+
+    std::optional<FourTuple> _tuple{};  //!< The connection the layouts were built for
+    Layout _plain{};                    //!< Without options
+    Layout _timestamps{};               //!< With the Timestamps option
+};
+
+#endif  // SPONGE_LIBSPONGE_ACK_TEMPLATE_HH
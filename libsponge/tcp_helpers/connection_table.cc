@@ -0,0 +1,13 @@
+#include "connection_table.hh"
+
+using namespace std;
+
+static string ipv4_to_string(const uint32_t ip) {
+    return to_string((ip >> 24) & 0xff) + "." + to_string((ip >> 16) & 0xff) + "." + to_string((ip >> 8) & 0xff) +
+           "." + to_string(ip & 0xff);
+}
+
+string FourTuple::to_string() const {
+    return ipv4_to_string(local_ip) + ":" + ::to_string(local_port) + " <-> " + ipv4_to_string(remote_ip) + ":" +
+           ::to_string(remote_port);
+}
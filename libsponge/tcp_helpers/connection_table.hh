@@ -0,0 +1,158 @@
+#ifndef SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
+#define SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! \brief The addresses and ports that identify one TCP connection, seen from our end
+//! \details For an incoming segment, `local` is its destination and `remote` its source;
+//! for an outgoing one it is the other way around.
+struct FourTuple {
+    uint32_t local_ip = 0;  //!< in host byte order
+    uint16_t local_port = 0;
+    uint32_t remote_ip = 0;  //!< in host byte order
+    uint16_t remote_port = 0;
+
+    bool operator==(const FourTuple &other) const {
+        return local_ip == other.local_ip and local_port == other.local_port and remote_ip == other.remote_ip and
+               remote_port == other.remote_port;
+    }
+    bool operator!=(const FourTuple &other) const { return not(*this == other); }
+
+    //! \brief Mix all 96 bits so that nearby ports and addresses land far apart
+    uint64_t hash() const {
+        uint64_t h = (uint64_t{local_ip} << 32) | remote_ip;
+        h ^= ((uint64_t{local_port} << 16) | remote_port) * 0x9e3779b97f4a7c15;
+        // splitmix64 finalizer
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+        return h ^ (h >> 31);
+    }
+
+    //! \brief e.g. "10.0.0.1:80 <-> 10.0.0.2:40000"
+    std::string to_string() const;
+};
+
+//! \brief A map from FourTuple to `V`, using open addressing with linear probing
+//! \details Entries live inline in one array, so a lookup usually touches a single cache line
+//! rather than chasing a bucket list. The table doubles whenever it becomes 3/4 full, and
+//! erase() shifts later entries of the probe run back instead of leaving tombstones, so lookups
+//! never slow down as connections come and go. Pointers returned by find() and insert() are
+//! invalidated by any later insert() or erase().
+template <typename V>
+class ConnectionTable {
+  private:
+    struct Slot {
+        FourTuple key{};
+        std::optional<V> value{};  //!< empty when the slot is free
+    };
+
+    std::vector<Slot> _slots;
+    size_t _size = 0;
+
+    size_t _mask() const { return _slots.size() - 1; }
+    size_t _home(const FourTuple &key) const { return key.hash() & _mask(); }
+
+    //! Index of the slot holding `key`, or of the free slot that ends its probe run.
+    size_t _probe(const FourTuple &key) const {
+        size_t i = _home(key);
+        while (_slots[i].value.has_value() and _slots[i].key != key) {
+            i = (i + 1) & _mask();
+        }
+        return i;
+    }
+
+    void _grow() {
+        std::vector<Slot> old(_slots.size() * 2);
+        std::swap(old, _slots);
+        for (auto &slot : old) {
+            if (slot.value.has_value()) {
+                Slot &dest = _slots[_probe(slot.key)];
+                dest.key = slot.key;
+                dest.value = std::move(slot.value);
+            }
+        }
+    }
+
+    static size_t _round_up(const size_t n) {
+        size_t capacity = 8;
+        while (capacity < n) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+  public:
+    //! \param[in] capacity number of slots to start with (rounded up to a power of two)
+    explicit ConnectionTable(const size_t capacity = 16) : _slots(_round_up(capacity)) {}
+
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+    size_t capacity() const { return _slots.size(); }
+
+    //! \returns the value for `key`, or `nullptr` if there is none
+    V *find(const FourTuple &key) {
+        Slot &slot = _slots[_probe(key)];
+        return slot.value.has_value() ? &*slot.value : nullptr;
+    }
+
+    const V *find(const FourTuple &key) const {
+        const Slot &slot = _slots[_probe(key)];
+        return slot.value.has_value() ? &*slot.value : nullptr;
+    }
+
+    //! \brief Add `value` under `key`, unless the key is already present
+    //! \returns the value stored under `key`, and whether it was inserted
+    std::pair<V *, bool> insert(const FourTuple &key, V &&value) {
+        if (4 * (_size + 1) > 3 * _slots.size()) {
+            _grow();
+        }
+        Slot &slot = _slots[_probe(key)];
+        if (slot.value.has_value()) {
+            return {&*slot.value, false};
+        }
+        slot.key = key;
+        slot.value = std::move(value);
+        _size++;
+        return {&*slot.value, true};
+    }
+
+    //! \returns `false` if there was no entry for `key`
+    bool erase(const FourTuple &key) {
+        size_t hole = _probe(key);
+        if (not _slots[hole].value.has_value()) {
+            return false;
+        }
+        _slots[hole].value.reset();
+        _size--;
+
+        // Walk the rest of the probe run; an entry that could have been placed at the hole moves into it.
+        for (size_t i = (hole + 1) & _mask(); _slots[i].value.has_value(); i = (i + 1) & _mask()) {
+            const size_t home = _home(_slots[i].key);
+            if (((i - home) & _mask()) >= ((i - hole) & _mask())) {
+                _slots[hole].key = _slots[i].key;
+                _slots[hole].value = std::move(_slots[i].value);
+                _slots[i].value.reset();
+                hole = i;
+            }
+        }
+        return true;
+    }
+
+    //! \brief Call `f(key, value)` for every entry, in no particular order
+    //! \note `f` must not insert or erase entries.
+    template <typename F>
+    void for_each(F &&f) {
+        for (auto &slot : _slots) {
+            if (slot.value.has_value()) {
+                f(static_cast<const FourTuple &>(slot.key), *slot.value);
+            }
+        }
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
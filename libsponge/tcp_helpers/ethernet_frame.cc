@@ -17,8 +17,9 @@ ParseResult EthernetFrame::parse(const Buffer buffer) {
 }
 
 BufferList EthernetFrame::serialize() const {
-    BufferList ret;
-    ret.append(_header.serialize());
+    Headroom headroom{EthernetHeader::LENGTH};
+    _header.prepend_to(headroom);
+    BufferList ret{move(headroom).release()};
     ret.append(_payload);
     return ret;
 }
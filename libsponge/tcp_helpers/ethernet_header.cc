@@ -4,6 +4,7 @@
 
 #include <iomanip>
 #include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -29,25 +30,32 @@ ParseResult EthernetHeader::parse(NetParser &p) {
 }
 
 string EthernetHeader::serialize() const {
-    string ret;
-    ret.reserve(LENGTH);
+    string ret(LENGTH, '\0');
+    serialize(ret.data(), ret.size());
+    return ret;
+}
+
+void EthernetHeader::serialize(char *dest, const size_t size) const {
+    if (size < LENGTH) {
+        throw runtime_error("no room for Ethernet header");
+    }
 
     /* write destination address */
     for (auto &byte : dst) {
-        NetUnparser::u8(ret, byte);
+        dest = NetUnparser::u8(dest, byte);
     }
 
     /* write source address */
     for (auto &byte : src) {
-        NetUnparser::u8(ret, byte);
+        dest = NetUnparser::u8(dest, byte);
     }
 
     /* write the frame's type (e.g. IPv4, ARP or something else) */
-    NetUnparser::u16(ret, type);
-
-    return ret;
+    NetUnparser::u16(dest, type);
 }
 
+void EthernetHeader::prepend_to(Headroom &headroom) const { serialize(headroom.prepend(LENGTH), LENGTH); }
+
 //! \returns A string with a textual representation of an Ethernet address
 string to_string(const EthernetAddress address) {
     stringstream ss{};
@@ -33,6 +33,12 @@ struct EthernetHeader {
     //! Serialize the Ethernet fields to a string
     std::string serialize() const;
 
+    //! Serialize the Ethernet fields into a caller's `size` bytes at `dest`, of which they take LENGTH
+    void serialize(char *dest, const size_t size) const;
+
+    //! Prepend the Ethernet fields to `headroom`
+    void prepend_to(Headroom &headroom) const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 };
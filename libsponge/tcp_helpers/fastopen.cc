@@ -0,0 +1,45 @@
+#include "fastopen.hh"
+
+using namespace std;
+
+FastOpenCookies::FastOpenCookies() : _hash(SipHash::random_key()) {}
+
+TCPHeader::FastOpenCookie FastOpenCookies::cookie(const uint32_t client_ip) const {
+    array<uint8_t, 4> bytes{};
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = static_cast<uint8_t>(client_ip >> (8 * i));
+    }
+    const uint64_t mac = _hash(bytes.data(), bytes.size());
+
+    TCPHeader::FastOpenCookie cookie;
+    cookie.length = LENGTH;
+    for (size_t i = 0; i < LENGTH; i++) {
+        cookie.bytes[i] = static_cast<uint8_t>(mac >> (8 * i));
+    }
+    return cookie;
+}
+
+void FastOpenCache::insert(const uint32_t server_ip, const TCPHeader::FastOpenCookie &cookie) {
+    if (_capacity == 0) {
+        return;
+    }
+    auto existing = _cookies.find(server_ip);
+    if (existing != _cookies.end()) {
+        existing->second = cookie;
+        return;
+    }
+    if (_cookies.size() >= _capacity) {
+        _cookies.erase(_order.front());
+        _order.pop();
+    }
+    _cookies.emplace(server_ip, cookie);
+    _order.push(server_ip);
+}
+
+optional<TCPHeader::FastOpenCookie> FastOpenCache::find(const uint32_t server_ip) const {
+    auto entry = _cookies.find(server_ip);
+    if (entry == _cookies.end()) {
+        return {};
+    }
+    return entry->second;
+}
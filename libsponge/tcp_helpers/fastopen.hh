@@ -0,0 +1,56 @@
+#ifndef SPONGE_LIBSPONGE_FASTOPEN_HH
+#define SPONGE_LIBSPONGE_FASTOPEN_HH
+
+#include "ring_queue.hh"
+#include "siphash.hh"
+#include "tcp_header.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+//! \brief The server side of [TCP Fast Open](https://tools.ietf.org/html/rfc7413): issuing cookies
+//! \details A cookie is a MAC over the client's address, so a client that presents it on a SYN has
+//! shown that it receives segments sent to that address, and the SYN's data can be accepted before
+//! the handshake completes.
+class FastOpenCookies {
+  public:
+    static constexpr uint8_t LENGTH = 8;  //!< Length of the cookies issued
+
+  private:
+    SipHash _hash;
+
+  public:
+    //! Cookies keyed with a random key
+    FastOpenCookies();
+
+    //! Cookies keyed with `key` (for testing)
+    explicit FastOpenCookies(const SipHash::Key &key) : _hash(key) {}
+
+    //! \brief The cookie for the client at `client_ip` (in host byte order)
+    TCPHeader::FastOpenCookie cookie(const uint32_t client_ip) const;
+};
+
+//! \brief The client side of TCP Fast Open: the latest cookie from each server
+//! \details Once full, the cache forgets the server whose cookie it learned first.
+class FastOpenCache {
+  private:
+    std::unordered_map<uint32_t, TCPHeader::FastOpenCookie> _cookies{};
+    RingQueue<uint32_t> _order{};  //!< Servers in the order they were first added, for eviction
+    size_t _capacity;
+
+  public:
+    //! \param[in] capacity number of servers to remember
+    explicit FastOpenCache(const size_t capacity = 1024) : _capacity(capacity) {}
+
+    //! \brief Remember `cookie` for the server at `server_ip`, replacing any older one
+    void insert(const uint32_t server_ip, const TCPHeader::FastOpenCookie &cookie);
+
+    //! \returns the cookie for the server at `server_ip`, or empty if there is none
+    std::optional<TCPHeader::FastOpenCookie> find(const uint32_t server_ip) const;
+
+    size_t size() const { return _cookies.size(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_FASTOPEN_HH
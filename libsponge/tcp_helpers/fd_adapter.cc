@@ -47,10 +47,51 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
 
 //! Serialize a TCP segment and send it as the payload of a UDP datagram.
 //! \param[in] seg is the TCP segment to write
+//! \note A segment with more than `config().mss` bytes of payload is split and sent as several datagrams.
 void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     seg.header().sport = config().source.port();
     seg.header().dport = config().destination.port();
-    _sock.sendto(config().destination, seg.serialize(0));
+    if (seg.payload().size() <= config().mss) {
+        _sock.sendto(config().destination, seg.serialize(0));
+        return;
+    }
+    for (const auto &piece : seg.split(config().mss)) {
+        _sock.sendto(config().destination, piece.serialize(0));
+    }
+}
+
+//! \details Unlike read(), this does not filter by peer and never changes the configuration.
+//! The local end of the FourTuple is the configured source address with the destination port
+//! from the TCP header; the remote end is the UDP sender, which is also where replies must go.
+//! \returns the segment and its FourTuple, or empty if the payload was not a valid TCP segment
+optional<pair<FourTuple, TCPSegment>> TCPOverUDPSocketAdapter::read_any() {
+    auto datagram = _sock.recv();
+
+    TCPSegment seg;
+    if (ParseResult::NoError != seg.parse(move(datagram.payload), 0)) {
+        return {};
+    }
+
+    const FourTuple tuple{config().source.ipv4_numeric(),
+                          seg.header().dport,
+                          datagram.source_address.ipv4_numeric(),
+                          datagram.source_address.port()};
+    return {{tuple, move(seg)}};
+}
+
+//! \param[in] tuple identifies the connection; the segment goes to `tuple.remote_ip:tuple.remote_port`
+//! \param[in] seg is the TCP segment to write (its ports are set from `tuple`)
+void TCPOverUDPSocketAdapter::write_to(const FourTuple &tuple, TCPSegment &seg) {
+    seg.header().sport = tuple.local_port;
+    seg.header().dport = tuple.remote_port;
+    const Address peer = Address::from_ipv4_numeric(tuple.remote_ip, tuple.remote_port);
+    if (seg.payload().size() <= config().mss) {
+        _sock.sendto(peer, seg.serialize(0));
+        return;
+    }
+    for (const auto &piece : seg.split(config().mss)) {
+        _sock.sendto(peer, piece.serialize(0));
+    }
 }
 
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
@@ -1,6 +1,7 @@
 #ifndef SPONGE_LIBSPONGE_FD_ADAPTER_HH
 #define SPONGE_LIBSPONGE_FD_ADAPTER_HH
 
+#include "connection_table.hh"
 #include "file_descriptor.hh"
 #include "lossy_fd_adapter.hh"
 #include "socket.hh"
@@ -57,6 +58,16 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
     //! Writes a TCP segment into a UDP payload
     void write(TCPSegment &seg);
 
+    //! \name Interface for serving many connections (see TCPMultiplexer)
+    //!@{
+
+    //! Reads a TCP segment from any peer, tagged with the FourTuple of its connection
+    std::optional<std::pair<FourTuple, TCPSegment>> read_any();
+
+    //! Writes a TCP segment to the peer of the connection identified by `tuple`
+    void write_to(const FourTuple &tuple, TCPSegment &seg);
+    //!@}
+
     //! Access the underlying UDP socket
     operator UDPSocket &() { return _sock; }
 
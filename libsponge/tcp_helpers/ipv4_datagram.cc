@@ -25,17 +25,9 @@ BufferList IPv4Datagram::serialize() const {
         throw runtime_error("IPv4Datagram::serialize: payload is wrong size");
     }
 
-    IPv4Header header_out = _header;
-    header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
-
-    // calculate checksum -- taken over header only
-    InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
-
-    BufferList ret;
-    ret.append(header_out.serialize());
+    Headroom headroom{size_t{4} * _header.hlen};
+    _header.prepend_to(headroom);
+    BufferList ret{move(headroom).release()};
     ret.append(_payload);
     return ret;
 }
@@ -2,12 +2,16 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <iomanip>
 #include <sstream>
 
 using namespace std;
 
+//! Where the checksum sits in a serialized IPv4 header
+static constexpr size_t CKSUM_OFFSET = 10;
+
 //! \param[in,out] p is a NetParser from which the IP fields will be extracted
 //! \returns a ParseResult indicating success or the reason for failure
 //! \details It is important to check for (at least) the following potential errors
@@ -24,27 +28,28 @@ ParseResult IPv4Header::parse(NetParser &p) {
     Buffer original_serialized_version = p.buffer();
 
     const size_t data_size = p.buffer().size();
-    if (data_size < IPv4Header::LENGTH) {
+    const optional<NetFields> fixed = p.fixed(IPv4Header::LENGTH);
+    if (not fixed) {
         return ParseResult::PacketTooShort;
     }
 
-    const uint8_t first_byte = p.u8();
+    const uint8_t first_byte = fixed->u8(0);
     ver = first_byte >> 4;     // version
     hlen = first_byte & 0x0f;  // header length
-    tos = p.u8();              // type of service
-    len = p.u16();             // length
-    id = p.u16();              // id
+    tos = fixed->u8(1);        // type of service
+    len = fixed->u16(2);       // length
+    id = fixed->u16(4);        // id
 
-    const uint16_t fo_val = p.u16();
+    const uint16_t fo_val = fixed->u16(6);
     df = static_cast<bool>(fo_val & 0x4000);  // don't fragment
     mf = static_cast<bool>(fo_val & 0x2000);  // more fragments
     offset = fo_val & 0x1fff;                 // offset
 
-    ttl = p.u8();     // ttl
-    proto = p.u8();   // proto
-    cksum = p.u16();  // checksum
-    src = p.u32();    // source address
-    dst = p.u32();    // destination address
+    ttl = fixed->u8(8);      // ttl
+    proto = fixed->u8(9);    // proto
+    cksum = fixed->u16(10);  // checksum
+    src = fixed->u32(12);    // source address
+    dst = fixed->u32(16);    // destination address
 
     if (data_size < 4 * hlen) {
         return ParseResult::PacketTooShort;
@@ -76,6 +81,13 @@ ParseResult IPv4Header::parse(NetParser &p) {
 
 //! Serialize the IPv4Header to a string (does not recompute the checksum)
 string IPv4Header::serialize() const {
+    string ret(4 * hlen, '\0');
+    serialize(ret.data(), ret.size());
+    return ret;
+}
+
+//! Serialize the IPv4Header into the `4 * hlen` bytes at `dest` (does not recompute the checksum)
+void IPv4Header::serialize(char *dest, const size_t size) const {
     // sanity checks
     if (ver != 4) {
         throw runtime_error("wrong IP version");
@@ -83,30 +95,42 @@ string IPv4Header::serialize() const {
     if (4 * hlen < IPv4Header::LENGTH) {
         throw runtime_error("IP header too short");
     }
-
-    string ret;
-    ret.reserve(4 * hlen);
+    if (4 * hlen > size) {
+        throw runtime_error("no room for IP header");
+    }
+    char *const end = dest + 4 * hlen;
 
     const uint8_t first_byte = (ver << 4) | (hlen & 0xf);
-    NetUnparser::u8(ret, first_byte);  // version and header length
-    NetUnparser::u8(ret, tos);         // type of service
-    NetUnparser::u16(ret, len);        // length
-    NetUnparser::u16(ret, id);         // id
+    dest = NetUnparser::u8(dest, first_byte);  // version and header length
+    dest = NetUnparser::u8(dest, tos);         // type of service
+    dest = NetUnparser::u16(dest, len);        // length
+    dest = NetUnparser::u16(dest, id);         // id
 
     const uint16_t fo_val = (df ? 0x4000 : 0) | (mf ? 0x2000 : 0) | (offset & 0x1fff);
-    NetUnparser::u16(ret, fo_val);  // flags and offset
+    dest = NetUnparser::u16(dest, fo_val);  // flags and offset
 
-    NetUnparser::u8(ret, ttl);    // time to live
-    NetUnparser::u8(ret, proto);  // protocol number
+    dest = NetUnparser::u8(dest, ttl);    // time to live
+    dest = NetUnparser::u8(dest, proto);  // protocol number
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    dest = NetUnparser::u16(dest, cksum);  // checksum
 
-    NetUnparser::u32(ret, src);  // src address
-    NetUnparser::u32(ret, dst);  // dst address
+    dest = NetUnparser::u32(dest, src);  // src address
+    dest = NetUnparser::u32(dest, dst);  // dst address
 
-    ret.resize(4 * hlen);  // expand header to advertised size
+    fill(dest, end, 0);  // expand header to advertised size
+}
 
-    return ret;
+void IPv4Header::prepend_to(Headroom &headroom) const {
+    const size_t length = 4 * hlen;
+    char *const dest = headroom.prepend(length);
+    IPv4Header header_out = *this;
+    header_out.cksum = 0;
+    header_out.serialize(dest, length);
+
+    // calculate checksum -- taken over header only
+    InternetChecksum check;
+    check.add({dest, length});
+    NetUnparser::u16(dest + CKSUM_OFFSET, check.value());
 }
 
 uint16_t IPv4Header::payload_length() const { return len - 4 * hlen; }
@@ -123,10 +147,13 @@ uint16_t IPv4Header::payload_length() const { return len - 4 * hlen; }
 //!  +--------+--------+--------+--------+
 //! ~~~
 uint32_t IPv4Header::pseudo_cksum() const {
+    return pseudo_cksum_partial() + payload_length();  // payload length
+}
+
+uint32_t IPv4Header::pseudo_cksum_partial() const {
     uint32_t pcksum = (src >> 16) + (src & 0xffff);  // source addr
     pcksum += (dst >> 16) + (dst & 0xffff);          // dest addr
     pcksum += proto;                                 // protocol
-    pcksum += payload_length();                      // payload length
     return pcksum;
 }
 
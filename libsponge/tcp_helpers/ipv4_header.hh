@@ -9,6 +9,7 @@ struct IPv4Header {
     static constexpr size_t LENGTH = 20;         //!< [IPv4](\ref rfc::rfc791) header length, not including options
     static constexpr uint8_t DEFAULT_TTL = 128;  //!< A reasonable default TTL value
     static constexpr uint8_t PROTO_TCP = 6;      //!< Protocol number for [tcp](\ref rfc::rfc793)
+    static constexpr uint8_t ECN_MASK = 0b11;    //!< Bits of `tos` that hold the ECN codepoint (RFC 3168)
 
     //! \struct IPv4Header
     //! ~~~{.txt}
@@ -33,7 +34,7 @@ struct IPv4Header {
     //!@{
     uint8_t ver = 4;            //!< IP version
     uint8_t hlen = LENGTH / 4;  //!< header length (multiples of 32 bits)
-    uint8_t tos = 0;            //!< type of service
+    uint8_t tos = 0;            //!< type of service (DSCP and, in the low two bits, ECN)
     uint16_t len = 0;           //!< total length of packet
     uint16_t id = 0;            //!< identification number
     bool df = true;             //!< don't fragment flag
@@ -52,12 +53,22 @@ struct IPv4Header {
     //! Serialize the IP fields
     std::string serialize() const;
 
+    //! Serialize the IP fields into a caller's `size` bytes at `dest`, of which they take `4 * hlen`
+    void serialize(char *dest, const size_t size) const;
+
+    //! Prepend the IP fields to `headroom`, with the checksum computed over them in place of `cksum`
+    void prepend_to(Headroom &headroom) const;
+
     //! Length of the payload
     uint16_t payload_length() const;
 
     //! [pseudo-header's](\ref rfc::rfc793) contribution to the TCP checksum
     uint32_t pseudo_cksum() const;
 
+    //! pseudo_cksum() without the payload length: the part that is the same for all of a connection's
+    //! segments, in both directions
+    uint32_t pseudo_cksum_partial() const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
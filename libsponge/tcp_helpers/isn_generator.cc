@@ -0,0 +1,110 @@
+#include "isn_generator.hh"
+
+#include <chrono>
+
+using namespace std;
+
+//! Lay out the 4-tuple for hashing, followed by room for `extra` bytes.
+template <size_t extra>
+static array<uint8_t, 12 + extra> tuple_bytes(const FourTuple &tuple) {
+    array<uint8_t, 12 + extra> bytes{};
+    for (size_t i = 0; i < 4; i++) {
+        bytes[i] = static_cast<uint8_t>(tuple.local_ip >> (8 * i));
+        bytes[4 + i] = static_cast<uint8_t>(tuple.remote_ip >> (8 * i));
+    }
+    for (size_t i = 0; i < 2; i++) {
+        bytes[8 + i] = static_cast<uint8_t>(tuple.local_port >> (8 * i));
+        bytes[10 + i] = static_cast<uint8_t>(tuple.remote_port >> (8 * i));
+    }
+    return bytes;
+}
+
+static uint64_t now_us() {
+    using namespace chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+IsnGenerator::IsnGenerator() : _hash(SipHash::random_key()), _random_key(true) {}
+
+IsnGenerator::IsnGenerator(const SipHash::Key &key) : _hash(key), _random_key(false) {}
+
+WrappingInt32 IsnGenerator::isn(const FourTuple &tuple, const uint64_t now_us) {
+    if (_random_key) {
+        if (not _keyed_at_us.has_value()) {
+            _keyed_at_us = now_us;
+        } else if (now_us - *_keyed_at_us >= REKEY_INTERVAL_US) {
+            _hash = SipHash(SipHash::random_key());
+            _keyed_at_us = now_us;
+        }
+    }
+    const auto bytes = tuple_bytes<0>(tuple);
+    const uint32_t m = static_cast<uint32_t>(now_us / 4);
+    return WrappingInt32{m + static_cast<uint32_t>(_hash(bytes.data(), bytes.size()))};
+}
+
+WrappingInt32 IsnGenerator::operator()(const FourTuple &tuple) { return isn(tuple, now_us()); }
+
+SynCookies::SynCookies() : _hash(SipHash::random_key()) {}
+
+uint32_t SynCookies::_mac(const FourTuple &tuple,
+                          const WrappingInt32 client_isn,
+                          const uint64_t counter,
+                          const uint8_t options) const {
+    auto bytes = tuple_bytes<13>(tuple);
+    for (size_t i = 0; i < 4; i++) {
+        bytes[12 + i] = static_cast<uint8_t>(client_isn.raw_value() >> (8 * i));
+    }
+    for (size_t i = 0; i < 8; i++) {
+        bytes[16 + i] = static_cast<uint8_t>(counter >> (8 * i));
+    }
+    bytes[24] = options;
+    return static_cast<uint32_t>(_hash(bytes.data(), bytes.size())) & 0x7f'ffff;
+}
+
+WrappingInt32 SynCookies::encode(const FourTuple &tuple,
+                                 const WrappingInt32 client_isn,
+                                 const Options &options,
+                                 const uint64_t now_ms) const {
+    uint8_t mss_index = 0;
+    if (options.mss.has_value()) {
+        // round down, but never below the smallest real entry
+        mss_index = 1;
+        while (mss_index + 1u < MSS_TABLE.size() and MSS_TABLE[mss_index + 1] <= *options.mss) {
+            mss_index++;
+        }
+    }
+    const uint8_t bits = static_cast<uint8_t>(mss_index << 1) | (options.timestamps ? 1 : 0);
+    const uint64_t counter = now_ms / PERIOD_MS;
+    const uint32_t cookie = (static_cast<uint32_t>(counter & 0x1f) << 27) | (uint32_t{bits} << 23) |
+                            _mac(tuple, client_isn, counter, bits);
+    return WrappingInt32{cookie};
+}
+
+uint32_t SynCookies::ts_offset(const FourTuple &tuple) const {
+    const auto bytes = tuple_bytes<0>(tuple);  // shorter than any input of _mac()
+    return static_cast<uint32_t>(_hash(bytes.data(), bytes.size()) >> 32);
+}
+
+optional<SynCookies::Options> SynCookies::decode(const FourTuple &tuple,
+                                                 const WrappingInt32 client_isn,
+                                                 const WrappingInt32 cookie,
+                                                 const uint64_t now_ms) const {
+    const uint32_t raw = cookie.raw_value();
+    const uint64_t now_counter = now_ms / PERIOD_MS;
+    const uint64_t age = (now_counter - (raw >> 27)) & 0x1f;
+    if (age > MAX_AGE or age > now_counter) {
+        return {};
+    }
+    const uint8_t bits = (raw >> 23) & 0xf;
+    if (_mac(tuple, client_isn, now_counter - age, bits) != (raw & 0x7f'ffff)) {
+        return {};
+    }
+
+    Options options;
+    const uint8_t mss_index = bits >> 1;
+    if (mss_index != 0) {
+        options.mss = MSS_TABLE[mss_index];
+    }
+    options.timestamps = bits & 1;
+    return options;
+}
@@ -0,0 +1,103 @@
+#ifndef SPONGE_LIBSPONGE_ISN_GENERATOR_HH
+#define SPONGE_LIBSPONGE_ISN_GENERATOR_HH
+
+#include "connection_table.hh"
+#include "siphash.hh"
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+//! \brief Initial sequence numbers per [RFC 6528](\ref rfc::rfc6528)
+//! \details ISN = M + F(4-tuple, secret key), where M is a clock ticking every 4 microseconds and
+//! F is SipHash. Successive connections with the same 4-tuple get increasing ISNs, while the ISNs
+//! of other connections reveal nothing about them. A random key is redrawn every
+//! #REKEY_INTERVAL_US, so it is never in use for long.
+class IsnGenerator {
+  public:
+    static constexpr uint64_t REKEY_INTERVAL_US = 3600ull * 1000 * 1000;  //!< one hour
+
+  private:
+    SipHash _hash;
+    bool _random_key;                          //!< Is the key random (and so due to be redrawn)?
+    std::optional<uint64_t> _keyed_at_us{};  //!< When the current random key was first used
+
+  public:
+    //! A generator with a random key, redrawn every #REKEY_INTERVAL_US
+    IsnGenerator();
+
+    //! A generator with a fixed key that is never redrawn (for testing)
+    explicit IsnGenerator(const SipHash::Key &key);
+
+    //! \brief The ISN for a new connection `tuple` at time `now_us` (microseconds, from any fixed origin)
+    WrappingInt32 isn(const FourTuple &tuple, const uint64_t now_us);
+
+    //! \brief The ISN for a new connection `tuple` now
+    WrappingInt32 operator()(const FourTuple &tuple);
+};
+
+//! \brief Stateless SYN/ACK sequence numbers that remember a SYN ("SYN cookies")
+//! \details Instead of keeping state for a SYN, a listener can answer it with an ISN that encodes
+//! what it needs later and a MAC over the 4-tuple and the client's ISN. A valid final ACK then
+//! acknowledges `cookie + 1`, from which decode() recovers the SYN's options.
+//!
+//! Layout of the 32-bit cookie:
+//! ~~~{.txt}
+//!   31      27 26  24 23 22                                          0
+//!  +----------+------+--+---------------------------------------------+
+//!  | counter  | MSS  |TS|                     MAC                     |
+//!  +----------+------+--+---------------------------------------------+
+//! ~~~
+//! `counter` is the low bits of a clock ticking every #PERIOD_MS, `MSS` an index into #MSS_TABLE,
+//! and `TS` whether the SYN offered the Timestamps option. A cookie is valid for up to #MAX_AGE
+//! periods after it was issued.
+class SynCookies {
+  public:
+    static constexpr uint64_t PERIOD_MS = 64000;  //!< Length of one tick of the cookie clock
+    static constexpr uint64_t MAX_AGE = 2;        //!< Oldest acceptable cookie, in periods
+
+    //! MSS values that fit in a cookie; index 0 means the SYN had no MSS option
+    static constexpr std::array<uint16_t, 8> MSS_TABLE{0, 536, 1000, 1220, 1440, 1460, 4312, 8960};
+
+    //! What a cookie remembers about the SYN
+    struct Options {
+        std::optional<uint16_t> mss{};  //!< The SYN's MSS, rounded down to an entry of #MSS_TABLE
+        bool timestamps = false;        //!< Did the SYN offer the Timestamps option?
+    };
+
+  private:
+    SipHash _hash;
+
+    uint32_t _mac(const FourTuple &tuple,
+                  const WrappingInt32 client_isn,
+                  const uint64_t counter,
+                  const uint8_t options) const;
+
+  public:
+    //! Cookies keyed with a random key
+    SynCookies();
+
+    //! Cookies keyed with `key` (for testing)
+    explicit SynCookies(const SipHash::Key &key) : _hash(key) {}
+
+    //! \brief The ISN for a SYN/ACK answering a SYN from `tuple` with sequence number `client_isn`
+    WrappingInt32 encode(const FourTuple &tuple,
+                         const WrappingInt32 client_isn,
+                         const Options &options,
+                         const uint64_t now_ms) const;
+
+    //! \brief Check the cookie acknowledged by a final ACK (`cookie` is its ackno minus one)
+    //! \returns the options of the original SYN, or empty if the cookie is forged or expired
+    std::optional<Options> decode(const FourTuple &tuple,
+                                  const WrappingInt32 client_isn,
+                                  const WrappingInt32 cookie,
+                                  const uint64_t now_ms) const;
+
+    //! \brief Offset of the timestamp clock for connections with `tuple` (RFC 7323 section 5.4)
+    //! \details Fixed for a tuple and unpredictable without the key, so a cookie SYN/ACK and the connection
+    //! that its final ACK creates later stamp TSvals from the same clock, with no state kept in between.
+    uint32_t ts_offset(const FourTuple &tuple) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_ISN_GENERATOR_HH
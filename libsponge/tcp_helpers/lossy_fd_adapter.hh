@@ -11,6 +11,9 @@
 #include <utility>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
+//! \details Like a router queue doing active queue management, it can also mark ECN-capable
+//! segments as having experienced congestion instead of dropping them (FdAdapterConfig::ce_rate_up
+//! and FdAdapterConfig::ce_rate_dn), so that ECN can be exercised without any loss.
 template <typename AdapterT>
 class LossyFdAdapter {
   private:
@@ -29,6 +32,19 @@ class LossyFdAdapter {
         return loss != 0 && uint16_t(_rand()) < loss;
     }
 
+    //! \brief Mark the segment CE, as a congested queue would, if it is ECN-capable and the dice say so
+    //! \param[in] uplink is `true` to use the uplink marking probability, else use the downlink one
+    void _maybe_mark(TCPSegment &seg, bool uplink) {
+        const auto &cfg = _adapter.config();
+        const uint16_t rate = uplink ? cfg.ce_rate_up : cfg.ce_rate_dn;
+        if (rate == 0 || seg.ecn() == TCPSegment::ECN_NOT_ECT) {
+            return;
+        }
+        if (uint16_t(_rand()) < rate) {
+            seg.set_ecn(TCPSegment::ECN_CE);
+        }
+    }
+
   public:
     //! Conversion to a FileDescriptor by returning the underlying AdapterT
     operator const FileDescriptor &() const { return _adapter; }
@@ -44,15 +60,19 @@ class LossyFdAdapter {
         if (_should_drop(false)) {
             return {};
         }
+        if (ret.has_value()) {
+            _maybe_mark(ret.value(), false);
+        }
         return ret;
     }
 
-    //! \brief Write to the underlying AdapterT instance, potentially dropping the datagram to be written
+    //! \brief Write to the underlying AdapterT instance, potentially dropping (or CE-marking) the datagram
     //! \param[in] seg is the packet to either write or drop
     void write(TCPSegment &seg) {
         if (_should_drop(true)) {
             return;
         }
+        _maybe_mark(seg, true);
         return _adapter.write(seg);
     }
 
@@ -16,10 +16,49 @@ class TCPConfig {
     static constexpr uint16_t TIMEOUT_DFLT = 1000;     //!< Default re-transmit timeout is 1 second
     static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up
 
+    //! Largest payload of a super-segment: a 64 KiB IPv4 datagram minus maximal IPv4 and TCP headers
+    static constexpr size_t GSO_MAX_PAYLOAD_SIZE = 65535 - 20 - 60;
+
     uint16_t rt_timeout = TIMEOUT_DFLT;       //!< Initial value of the retransmission timeout, in milliseconds
     size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
     size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
     std::optional<WrappingInt32> fixed_isn{};
+
+    //! Offset of the timestamp clock (RFC 7323 section 5.4), if set (otherwise a random offset is used)
+    std::optional<uint32_t> fixed_ts_offset{};
+
+    //! Emit super-segments of up to GSO_MAX_PAYLOAD_SIZE bytes and leave the
+    //! split into wire-sized segments to the FdAdapter (software segmentation offload)
+    bool gso = false;
+
+    //! Offer the Timestamps option (RFC 7323) for RTT measurement and PAWS
+    bool timestamps = false;
+
+    //! Detect losses by transmit time and probe for tail losses (RACK-TLP, RFC 8985)
+    bool rack = false;
+
+    //! Probe a zero window from a persist timer with exponential backoff (RFC 1122 section 4.2.2.17),
+    //! instead of treating it as a window of one byte retransmitted at the RTO without backoff
+    bool persist_timer = false;
+
+    //! Announce MAX_PAYLOAD_SIZE in the Maximum Segment Size option of our SYN
+    //! (the peer's MSS option is honored either way)
+    bool announce_mss = false;
+
+    //! TCP Fast Open (RFC 7413): request and present cookies on our SYNs, carrying data once we
+    //! have one, and accept data on SYNs that present a valid cookie (see TCPConnection::set_fastopen_cookie())
+    bool fastopen = false;
+
+    //! Explicit Congestion Notification (RFC 3168): negotiate it on the handshake, send data as ECN-capable,
+    //! echo congestion marks with ECE, and answer echoed marks by shrinking a congestion window (and CWR)
+    bool ecn = false;
+
+    //! \name Keepalive (RFC 1122 section 4.2.3.6), off unless `keepalive_idle_ms` is set
+    //!@{
+    uint32_t keepalive_idle_ms = 0;          //!< Silence from the peer before the first probe (0: no keepalive)
+    uint32_t keepalive_interval_ms = 75000;  //!< Time between unanswered probes
+    uint8_t keepalive_probes = 9;            //!< Unanswered probes before the connection is reset
+    //!@}
 };
 
 //! Config for classes derived from FdAdapter
@@ -30,6 +69,10 @@ class FdAdapterConfig {
 
     uint16_t loss_rate_dn = 0;  //!< Downlink loss rate (for LossyFdAdapter)
     uint16_t loss_rate_up = 0;  //!< Uplink loss rate (for LossyFdAdapter)
+    uint16_t ce_rate_dn = 0;    //!< Downlink rate of CE marks on ECN-capable segments (for LossyFdAdapter)
+    uint16_t ce_rate_up = 0;    //!< Uplink rate of CE marks on ECN-capable segments (for LossyFdAdapter)
+
+    size_t mss = TCPConfig::MAX_PAYLOAD_SIZE;  //!< Largest payload per written segment; larger ones are split
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_CONFIG_HH
@@ -1,9 +1,15 @@
 #include "tcp_header.hh"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
 
+//! A cookie request is empty; a cookie has an even length from 4 to 16 bytes (RFC 7413 section 4.1.1).
+static bool fastopen_length_ok(const size_t length) {
+    return length == 0 or (length >= 4 and length <= TCPHeader::FastOpenCookie::MAX_LENGTH and length % 2 == 0);
+}
+
 //! \param[in,out] p is a NetParser from which the TCP fields will be extracted
 //! \returns a ParseResult indicating success or the reason for failure
 //! \details It is important to check for (at least) the following potential errors
@@ -15,13 +21,20 @@ using namespace std;
 //! - there is less data in the header than the `doff` field claims
 //! - the checksum is bad
 ParseResult TCPHeader::parse(NetParser &p) {
-    sport = p.u16();                 // source port
-    dport = p.u16();                 // destination port
-    seqno = WrappingInt32{p.u32()};  // sequence number
-    ackno = WrappingInt32{p.u32()};  // ack number
-    doff = p.u8() >> 4;              // data offset
+    // the fixed part's length is checked once, and its fields loaded straight from the bytes
+    const optional<NetFields> fixed = p.fixed(TCPHeader::LENGTH);
+    if (not fixed) {
+        return p.get_error();
+    }
+    sport = fixed->u16(0);                 // source port
+    dport = fixed->u16(2);                 // destination port
+    seqno = WrappingInt32{fixed->u32(4)};  // sequence number
+    ackno = WrappingInt32{fixed->u32(8)};  // ack number
+    doff = fixed->u8(12) >> 4;             // data offset
 
-    const uint8_t fl_b = p.u8();                  // byte including flags
+    const uint8_t fl_b = fixed->u8(13);           // byte including flags
+    cwr = static_cast<bool>(fl_b & 0b1000'0000);
+    ece = static_cast<bool>(fl_b & 0b0100'0000);
     urg = static_cast<bool>(fl_b & 0b0010'0000);  // binary literals and ' digit separator since C++14!!!
     ack = static_cast<bool>(fl_b & 0b0001'0000);
     psh = static_cast<bool>(fl_b & 0b0000'1000);
@@ -29,52 +42,193 @@ ParseResult TCPHeader::parse(NetParser &p) {
     syn = static_cast<bool>(fl_b & 0b0000'0010);
     fin = static_cast<bool>(fl_b & 0b0000'0001);
 
-    win = p.u16();    // window size
-    cksum = p.u16();  // checksum
-    uptr = p.u16();   // urgent pointer
+    win = fixed->u16(14);    // window size
+    cksum = fixed->u16(16);  // checksum
+    uptr = fixed->u16(18);   // urgent pointer
 
     if (doff < 5) {
         return ParseResult::HeaderTooShort;
     }
 
-    // skip any options or anything extra in the header
-    p.remove_prefix(doff * 4 - TCPHeader::LENGTH);
-
-    if (p.error()) {
+    // walk the options, keeping the ones we understand and skipping the rest
+    mss.reset();
+    ts.reset();
+    fastopen.reset();
+    wscale.reset();
+    sack_permitted = false;
+    sack = SackBlocks{};
+    const size_t opt_length = doff * 4 - TCPHeader::LENGTH;
+    const optional<NetFields> opts = p.fixed(opt_length);
+    if (not opts) {
         return p.get_error();
     }
+    size_t i = 0;
+    while (i < opt_length) {
+        const uint8_t kind = opts->u8(i++);
+        if (kind == OPT_EOL) {
+            break;  // whatever follows an end-of-options marker is skipped
+        }
+        if (kind == OPT_NOP) {
+            continue;
+        }
+        if (i == opt_length) {
+            return ParseResult::HeaderTooShort;
+        }
+        const uint8_t len = opts->u8(i++);
+        if (len < 2 or len - 2u > opt_length - i) {
+            return ParseResult::HeaderTooShort;
+        }
+        if (kind == OPT_MSS and len == MSS_LEN) {
+            mss = opts->u16(i);
+        } else if (kind == OPT_WSCALE and len == WSCALE_LEN) {
+            wscale = opts->u8(i);
+        } else if (kind == OPT_SACK_PERMITTED and len == SACK_PERMITTED_LEN) {
+            sack_permitted = true;
+        } else if (kind == OPT_SACK and len > 2 and (len - 2u) % SACK_BLOCK_LEN == 0) {
+            for (size_t off = i; off < i + len - 2u; off += SACK_BLOCK_LEN) {
+                SackBlock block;
+                block.left = WrappingInt32{opts->u32(off)};
+                block.right = WrappingInt32{opts->u32(off + 4)};
+                sack.push_back(block);  // empty blocks, and blocks past SackBlocks::MAX_BLOCKS, are dropped
+            }
+        } else if (kind == OPT_TIMESTAMPS and len == TIMESTAMPS_LEN) {
+            Timestamps opt;
+            opt.val = opts->u32(i);
+            opt.ecr = opts->u32(i + 4);
+            ts = opt;
+        } else if (kind == OPT_FASTOPEN and fastopen_length_ok(len - 2u)) {
+            FastOpenCookie cookie;
+            cookie.length = static_cast<uint8_t>(len - 2u);
+            for (size_t j = 0; j < cookie.length; j++) {
+                cookie.bytes[j] = opts->u8(i + j);
+            }
+            fastopen = cookie;
+        }
+        i += len - 2u;
+    }
 
     return ParseResult::NoError;
 }
 
+//! Bytes taken by the Fast Open option, with the NOPs that pad it to a multiple of four.
+static size_t fastopen_option_length(const TCPHeader::FastOpenCookie &cookie) {
+    return (2 + cookie.length + 3) / 4 * 4;
+}
+
+//! Bytes taken by the SACK option: NOP, NOP, kind, length, then the blocks.
+static size_t sack_option_length(const TCPHeader::SackBlocks &sack) {
+    return sack.empty() ? 0 : 4 + TCPHeader::SACK_BLOCK_LEN * sack.size();
+}
+
+//! \details Every option is padded with leading NOPs to a multiple of four bytes, so that the
+//! 32-bit values in the Timestamps and SACK options stay aligned. SACK-Permitted takes the place of
+//! the NOPs in front of Timestamps when both are present, as Linux does, which leaves room on a SYN
+//! for MSS, Window Scale, SACK-Permitted, Timestamps and the longest Fast Open cookie.
+size_t TCPHeader::serialized_length() const {
+    const size_t ts_and_sack_permitted = ts.has_value() ? 2 + TIMESTAMPS_LEN : (sack_permitted ? 4 : 0);
+    const size_t options_length = (mss.has_value() ? MSS_LEN : 0) + ts_and_sack_permitted +
+                                  (wscale.has_value() ? 1 + WSCALE_LEN : 0) + sack_option_length(sack) +
+                                  (fastopen.has_value() ? fastopen_option_length(*fastopen) : 0);
+    return std::max<size_t>(4 * doff, LENGTH + options_length);
+}
+
+uint8_t TCPHeader::flags() const {
+    return (cwr ? 0b1000'0000 : 0) | (ece ? 0b0100'0000 : 0) | (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) |
+           (psh ? 0b0000'1000 : 0) | (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
+}
+
 //! Serialize the TCPHeader to a string (does not recompute the checksum)
 string TCPHeader::serialize() const {
+    string ret(serialized_length(), '\0');
+    serialize(ret.data(), ret.size());
+    return ret;
+}
+
+//! Serialize the TCPHeader into the serialized_length() bytes at `dest` (does not recompute the checksum)
+void TCPHeader::serialize(char *dest, const size_t size) const {
     // sanity check
     if (doff < 5) {
         throw runtime_error("TCP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * doff);
+    const size_t length = serialized_length();
+    if (length > LENGTH + MAX_OPTIONS_LENGTH) {
+        throw runtime_error("TCP options too long");
+    }
+    if (length > size) {
+        throw runtime_error("no room for TCP header");
+    }
+    char *const end = dest + length;
 
-    NetUnparser::u16(ret, sport);              // source port
-    NetUnparser::u16(ret, dport);              // destination port
-    NetUnparser::u32(ret, seqno.raw_value());  // sequence number
-    NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
+    dest = NetUnparser::u16(dest, sport);              // source port
+    dest = NetUnparser::u16(dest, dport);              // destination port
+    dest = NetUnparser::u32(dest, seqno.raw_value());  // sequence number
+    dest = NetUnparser::u32(dest, ackno.raw_value());  // ack number
+    dest = NetUnparser::u8(dest, (length / 4) << 4);   // data offset
 
-    const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) |
-                         (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
-    NetUnparser::u8(ret, fl_b);  // flags
-    NetUnparser::u16(ret, win);  // window size
+    dest = NetUnparser::u8(dest, flags());  // flags
+    dest = NetUnparser::u16(dest, win);      // window size
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    dest = NetUnparser::u16(dest, cksum);  // checksum
 
-    NetUnparser::u16(ret, uptr);  // urgent pointer
+    dest = NetUnparser::u16(dest, uptr);  // urgent pointer
 
-    ret.resize(4 * doff);  // expand header to advertised size
+    if (mss.has_value()) {
+        dest = NetUnparser::u8(dest, OPT_MSS);
+        dest = NetUnparser::u8(dest, MSS_LEN);
+        dest = NetUnparser::u16(dest, *mss);
+    }
 
-    return ret;
+    if (sack_permitted) {
+        if (not ts.has_value()) {
+            dest = NetUnparser::u8(dest, OPT_NOP);
+            dest = NetUnparser::u8(dest, OPT_NOP);
+        }
+        dest = NetUnparser::u8(dest, OPT_SACK_PERMITTED);
+        dest = NetUnparser::u8(dest, SACK_PERMITTED_LEN);
+    }
+
+    if (ts.has_value()) {
+        if (not sack_permitted) {
+            dest = NetUnparser::u8(dest, OPT_NOP);
+            dest = NetUnparser::u8(dest, OPT_NOP);
+        }
+        dest = NetUnparser::u8(dest, OPT_TIMESTAMPS);
+        dest = NetUnparser::u8(dest, TIMESTAMPS_LEN);
+        dest = NetUnparser::u32(dest, ts->val);
+        dest = NetUnparser::u32(dest, ts->ecr);
+    }
+
+    if (wscale.has_value()) {
+        dest = NetUnparser::u8(dest, OPT_NOP);
+        dest = NetUnparser::u8(dest, OPT_WSCALE);
+        dest = NetUnparser::u8(dest, WSCALE_LEN);
+        dest = NetUnparser::u8(dest, *wscale);
+    }
+
+    if (not sack.empty()) {
+        dest = NetUnparser::u8(dest, OPT_NOP);
+        dest = NetUnparser::u8(dest, OPT_NOP);
+        dest = NetUnparser::u8(dest, OPT_SACK);
+        dest = NetUnparser::u8(dest, 2 + SACK_BLOCK_LEN * sack.size());
+        for (const SackBlock &block : sack) {
+            dest = NetUnparser::u32(dest, block.left.raw_value());
+            dest = NetUnparser::u32(dest, block.right.raw_value());
+        }
+    }
+
+    if (fastopen.has_value()) {
+        for (size_t i = 2 + fastopen->length; i < fastopen_option_length(*fastopen); i++) {
+            dest = NetUnparser::u8(dest, OPT_NOP);
+        }
+        dest = NetUnparser::u8(dest, OPT_FASTOPEN);
+        dest = NetUnparser::u8(dest, 2 + fastopen->length);
+        for (size_t i = 0; i < fastopen->length; i++) {
+            dest = NetUnparser::u8(dest, fastopen->bytes[i]);
+        }
+    }
+
+    fill(dest, end, OPT_EOL);  // expand header to advertised size (zero bytes are end-of-options)
 }
 
 //! \returns A string with the header's contents
@@ -85,24 +239,48 @@ string TCPHeader::to_string() const {
        << "TCP seqno: " << seqno << '\n'
        << "TCP ackno: " << ackno << '\n'
        << "TCP doff: " << +doff << '\n'
-       << "Flags: urg: " << urg << " ack: " << ack << " psh: " << psh << " rst: " << rst << " syn: " << syn
-       << " fin: " << fin << '\n'
+       << "Flags: cwr: " << cwr << " ece: " << ece << " urg: " << urg << " ack: " << ack << " psh: " << psh
+       << " rst: " << rst << " syn: " << syn << " fin: " << fin << '\n'
        << "TCP winsize: " << +win << '\n'
        << "TCP cksum: " << +cksum << '\n'
        << "TCP uptr: " << +uptr << '\n';
+    if (mss.has_value()) {
+        ss << "TCP MSS: " << +*mss << '\n';
+    }
+    if (wscale.has_value()) {
+        ss << "TCP window scale: " << dec << +*wscale << hex << '\n';
+    }
+    if (sack_permitted) {
+        ss << "TCP SACK permitted\n";
+    }
+    for (const SackBlock &block : sack) {
+        ss << "TCP SACK block: " << block.left << " to " << block.right << '\n';
+    }
+    if (ts.has_value()) {
+        ss << "TCP timestamps: val " << ts->val << " ecr " << ts->ecr << '\n';
+    }
+    if (fastopen.has_value()) {
+        if (fastopen->empty()) {
+            ss << "TCP fast open: cookie request\n";
+        } else {
+            ss << "TCP fast open: " << dec << +fastopen->length << "-byte cookie\n";
+        }
+    }
     return ss.str();
 }
 
 string TCPHeader::summary() const {
     stringstream ss{};
     ss << "Header(flags=" << (syn ? "S" : "") << (ack ? "A" : "") << (rst ? "R" : "") << (fin ? "F" : "")
-       << ",seqno=" << seqno << ",ack=" << ackno << ",win=" << win << ")";
+       << (ece ? "E" : "") << (cwr ? "C" : "") << ",seqno=" << seqno << ",ack=" << ackno << ",win=" << win << ")";
     return ss.str();
 }
 
 bool TCPHeader::operator==(const TCPHeader &other) const {
     // TODO(aozdemir) more complete check (right now we omit cksum, src, dst
-    return seqno == other.seqno && ackno == other.ackno && doff == other.doff && urg == other.urg && ack == other.ack &&
+    return seqno == other.seqno && ackno == other.ackno && doff == other.doff && cwr == other.cwr &&
+           ece == other.ece && urg == other.urg && ack == other.ack &&
            psh == other.psh && rst == other.rst && syn == other.syn && fin == other.fin && win == other.win &&
-           uptr == other.uptr;
+           uptr == other.uptr && mss == other.mss && ts == other.ts && fastopen == other.fastopen &&
+           wscale == other.wscale && sack_permitted == other.sack_permitted && sack == other.sack;
 }
@@ -4,11 +4,98 @@
 #include "parser.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
+#include <array>
+#include <optional>
+
 //! \brief [TCP](\ref rfc::rfc793) segment header
-//! \note TCP options are not supported
+//! \note The options understood are Maximum Segment Size, Window Scale and Timestamps (RFC 7323),
+//! SACK-Permitted and SACK (RFC 2018), and TCP Fast Open (RFC 7413); others are skipped. Options are
+//! held inline, so copying a header never allocates.
 struct TCPHeader {
     static constexpr size_t LENGTH = 20;  //!< [TCP](\ref rfc::rfc793) header length, not including options
 
+    //! Contents of the Timestamps option (kind 8)
+    struct Timestamps {
+        uint32_t val = 0;  //!< TSval, the sender's timestamp clock
+        uint32_t ecr = 0;  //!< TSecr, the most recent TSval received from the peer
+
+        bool operator==(const Timestamps &other) const { return val == other.val && ecr == other.ecr; }
+    };
+
+    //! Contents of the TCP Fast Open option (kind 34): a cookie, or a request for one if empty
+    struct FastOpenCookie {
+        static constexpr size_t MAX_LENGTH = 16;  //!< Longest cookie (RFC 7413 section 4.1.1)
+
+        std::array<uint8_t, MAX_LENGTH> bytes{};
+        uint8_t length = 0;
+
+        bool empty() const { return length == 0; }
+
+        bool operator==(const FastOpenCookie &other) const {
+            return length == other.length && std::equal(bytes.begin(), bytes.begin() + length, other.bytes.begin());
+        }
+        bool operator!=(const FastOpenCookie &other) const { return !(*this == other); }
+    };
+
+    //! One block of the SACK option: the sequence numbers `[left, right)` have been received
+    struct SackBlock {
+        WrappingInt32 left{0};   //!< First sequence number of the block
+        WrappingInt32 right{0};  //!< Sequence number just past the block
+
+        bool operator==(const SackBlock &other) const { return left == other.left && right == other.right; }
+    };
+
+    //! Contents of the SACK option (kind 5): up to MAX_BLOCKS blocks, in a fixed inline array
+    struct SackBlocks {
+        //! Blocks kept from one option: as many as fit next to the Timestamps option (RFC 2018 section 3).
+        //! A fourth block, which only fits without timestamps, is skipped when parsing.
+        static constexpr size_t MAX_BLOCKS = 3;
+
+        //! The blocks in use come first. The rest are empty (`left == right`, which no real block is),
+        //! so that no count is needed and the option fits in the header without padding.
+        std::array<SackBlock, MAX_BLOCKS> blocks{};
+
+        size_t size() const {
+            return std::find_if(blocks.begin(), blocks.end(), [](const SackBlock &b) { return b.left == b.right; }) -
+                   blocks.begin();
+        }
+        bool empty() const { return size() == 0; }
+        bool full() const { return size() == MAX_BLOCKS; }
+
+        //! Append a block if there is room and it is not empty; \returns whether it was kept
+        bool push_back(const SackBlock &block) {
+            const size_t n = size();
+            if (n == MAX_BLOCKS or block.left == block.right) {
+                return false;
+            }
+            blocks[n] = block;
+            return true;
+        }
+
+        const SackBlock *begin() const { return blocks.data(); }
+        const SackBlock *end() const { return blocks.data() + size(); }
+
+        bool operator==(const SackBlocks &other) const { return blocks == other.blocks; }
+    };
+
+    static constexpr size_t MAX_OPTIONS_LENGTH = 40;  //!< Room for options: a 15-word header less LENGTH
+
+    static constexpr uint8_t OPT_EOL = 0;            //!< End of option list
+    static constexpr uint8_t OPT_NOP = 1;            //!< No-operation (padding)
+    static constexpr uint8_t OPT_MSS = 2;            //!< Maximum Segment Size option kind
+    static constexpr size_t MSS_LEN = 4;             //!< Maximum Segment Size option length (kind, length, MSS)
+    static constexpr uint8_t OPT_WSCALE = 3;         //!< Window Scale option kind
+    static constexpr size_t WSCALE_LEN = 3;          //!< Window Scale option length (kind, length, shift count)
+    static constexpr uint8_t MAX_WSCALE = 14;        //!< Largest meaningful shift count (RFC 7323 section 2.3)
+    static constexpr uint8_t OPT_SACK_PERMITTED = 4;  //!< SACK-Permitted option kind
+    static constexpr size_t SACK_PERMITTED_LEN = 2;  //!< SACK-Permitted option length (kind, length)
+    static constexpr uint8_t OPT_SACK = 5;           //!< SACK option kind
+    static constexpr size_t SACK_BLOCK_LEN = 8;      //!< Bytes per block in the SACK option (left, right edge)
+    static constexpr uint8_t OPT_TIMESTAMPS = 8;     //!< Timestamps option kind
+    static constexpr size_t TIMESTAMPS_LEN = 10;     //!< Timestamps option length (kind, length, TSval, TSecr)
+    static constexpr uint8_t OPT_FASTOPEN = 34;      //!< TCP Fast Open cookie option kind
+
     //! \struct TCPHeader
     //! ~~~{.txt}
     //!   0                   1                   2                   3
@@ -20,9 +107,9 @@ struct TCPHeader {
     //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     //!  |                    Acknowledgment Number                      |
     //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    //!  |  Data |           |U|A|P|R|S|F|                               |
-    //!  | Offset| Reserved  |R|C|S|S|Y|I|            Window             |
-    //!  |       |           |G|K|H|T|N|N|                               |
+    //!  |  Data |       |C|E|U|A|P|R|S|F|                               |
+    //!  | Offset| Rsrvd |W|C|R|C|S|S|Y|I|            Window             |
+    //!  |       |       |R|E|G|K|H|T|N|N|                               |
     //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     //!  |           Checksum            |         Urgent Pointer        |
     //!  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -39,6 +126,8 @@ struct TCPHeader {
     WrappingInt32 seqno{0};     //!< sequence number
     WrappingInt32 ackno{0};     //!< ack number
     uint8_t doff = LENGTH / 4;  //!< data offset
+    bool cwr = false;           //!< congestion window reduced flag (RFC 3168)
+    bool ece = false;           //!< ECN-echo flag (RFC 3168)
     bool urg = false;           //!< urgent flag
     bool ack = false;           //!< ack flag
     bool psh = false;           //!< push flag
@@ -50,12 +139,33 @@ struct TCPHeader {
     uint16_t uptr = 0;          //!< urgent pointer
     //!@}
 
+    //! \name TCP options
+    //!@{
+    std::optional<uint16_t> mss{};   //!< Maximum Segment Size option, if present (only valid on a SYN)
+    std::optional<Timestamps> ts{};  //!< Timestamps option, if present
+    std::optional<FastOpenCookie> fastopen{};  //!< TCP Fast Open option, if present (only valid on a SYN)
+    std::optional<uint8_t> wscale{};           //!< Window Scale shift count, if present (only valid on a SYN)
+    bool sack_permitted = false;               //!< SACK-Permitted option present (only valid on a SYN)
+    SackBlocks sack{};                         //!< SACK option blocks (none if the option is absent)
+    //!@}
+
     //! Parse the TCP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
     //! Serialize the TCP fields
+    //! \throws std::runtime_error if `doff` is too small or the options take more than MAX_OPTIONS_LENGTH bytes
     std::string serialize() const;
 
+    //! Serialize the TCP fields into a caller's `size` bytes at `dest`, of which they take serialized_length()
+    //! \throws std::runtime_error as serialize() does, or if `size` is too small
+    void serialize(char *dest, const size_t size) const;
+
+    //! The byte that holds the flags, as serialized
+    uint8_t flags() const;
+
+    //! Number of bytes serialize() produces: `4 * doff`, grown if needed to fit the options
+    size_t serialized_length() const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
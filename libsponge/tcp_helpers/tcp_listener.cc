@@ -0,0 +1,170 @@
+#include "tcp_listener.hh"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+TCPListener::TCPListener(const TCPConfig &cfg,
+                         const size_t syn_backlog,
+                         const size_t accept_backlog,
+                         const uint64_t syn_timeout_ms)
+    : _cfg(cfg)
+    , _connections(cfg)
+    , _syn_backlog(syn_backlog)
+    , _accept_backlog(accept_backlog)
+    , _syn_timeout_ms(syn_timeout_ms) {}
+
+bool TCPListener::_admit(const FourTuple &tuple, const TCPSegment &syn) {
+    if (_accept_queue.size() >= _accept_backlog) {
+        _syns_dropped++;
+        return false;
+    }
+    if (_syn_queue.size() >= _syn_backlog) {
+        if (_syn_cookies) {
+            _send_cookie(tuple, syn);
+        } else {
+            _syns_dropped++;
+        }
+        return false;
+    }
+    _connections.listen(tuple);
+    _syn_queue.insert(tuple, _syn_timers.schedule(_syn_timeout_ms, [this, tuple] { _syn_expired(tuple); }));
+    return true;
+}
+
+//! \details The SYN/ACK is what the connection would have sent, except for its sequence number.
+//! Its TSval comes from the tuple's timestamp clock, which the connection takes over; see _accept_cookie().
+void TCPListener::_send_cookie(const FourTuple &tuple, const TCPSegment &syn) {
+    SynCookies::Options options;
+    options.mss = syn.header().mss;
+    options.timestamps = _cfg.timestamps and syn.header().ts.has_value();
+
+    TCPSegment synack;
+    TCPHeader &header = synack.header();
+    header.syn = true;
+    header.ack = true;
+    header.seqno = _cookies.encode(tuple, syn.header().seqno, options, _syn_timers.now_ms());
+    header.ackno = syn.header().seqno + 1;
+    header.win = static_cast<uint16_t>(min<size_t>(_cfg.recv_capacity, numeric_limits<uint16_t>::max()));
+    if (_cfg.announce_mss) {
+        header.mss = TCPConfig::MAX_PAYLOAD_SIZE;
+    }
+    if (options.timestamps) {
+        header.ts = TCPHeader::Timestamps{_ts_value(tuple), syn.header().ts->val};
+    }
+    _connections.segments_out().emplace(tuple, move(synack));
+    _cookies_sent++;
+}
+
+//! \details The connection is rebuilt by replaying the SYN that the cookie describes (with the
+//! cookie as our ISN) and discarding the SYN/ACK this produces, which the peer already has.
+//! Its timestamp clock starts where the tuple's clock stands now, so that its TSvals carry on from
+//! the one in the cookie SYN/ACK, which the peer keeps as TS.Recent; then the final ACK is delivered.
+bool TCPListener::_accept_cookie(const FourTuple &tuple, const TCPSegment &ack) {
+    const TCPHeader &header = ack.header();
+    const WrappingInt32 client_isn = header.seqno - 1;
+    const WrappingInt32 cookie = header.ackno - 1;
+    const auto options = _cookies.decode(tuple, client_isn, cookie, _syn_timers.now_ms());
+    if (not options.has_value()) {
+        return false;
+    }
+    if (_accept_queue.size() >= _accept_backlog) {
+        _syns_dropped++;
+        return true;
+    }
+
+    TCPSegment syn;
+    syn.header().syn = true;
+    syn.header().seqno = client_isn;
+    syn.header().win = header.win;
+    syn.header().mss = options->mss;
+    if (options->timestamps and header.ts.has_value()) {
+        syn.header().ts = TCPHeader::Timestamps{header.ts->val, 0};
+    }
+    TCPConnection &conn = _connections.listen(tuple, cookie, _ts_value(tuple));
+    conn.segment_received(syn);
+    conn.segments_out().clear();
+
+    _connections.segment_received(tuple, ack);
+
+    const TCPConnection *established = _connections.find(tuple);
+    if (established != nullptr and established->handshake_complete()) {
+        _accept_queue.push(tuple);
+        _cookies_accepted++;
+    } else {
+        _connections.drop(tuple);
+    }
+    return true;
+}
+
+uint32_t TCPListener::_ts_value(const FourTuple &tuple) const {
+    return _cookies.ts_offset(tuple) + static_cast<uint32_t>(_syn_timers.now_ms());
+}
+
+void TCPListener::_syn_expired(const FourTuple &tuple) {
+    if (_syn_queue.erase(tuple)) {
+        _connections.drop(tuple);
+    }
+}
+
+//! \details Segments for connections that already exist go straight to the multiplexer, as does
+//! anything for a new tuple other than a plain SYN or (with SYN cookies on) an ACK with a valid
+//! cookie. Once a half-open connection has seen the segment, it leaves the SYN queue if its
+//! handshake completed (for the accept queue) or it was reset.
+//!
+//! While the accept queue is full, an ACK for a half-open connection is dropped, as Linux does: the
+//! connection stays in the SYN queue, and the peer's answer to its retransmitted SYN/ACK tries again.
+void TCPListener::segment_received(const FourTuple &tuple, const TCPSegment &seg) {
+    const TCPHeader &header = seg.header();
+    if (_connections.find(tuple) == nullptr) {
+        if (header.syn and not header.ack and not header.rst and not _admit(tuple, seg)) {
+            return;
+        }
+        if (_syn_cookies and header.ack and not header.syn and not header.rst and _accept_cookie(tuple, seg)) {
+            return;
+        }
+    }
+
+    const TimingWheel::TimerId *timer = _syn_queue.find(tuple);
+    if (timer != nullptr and header.ack and not header.rst and _accept_queue.size() >= _accept_backlog) {
+        _acks_dropped++;
+        return;
+    }
+
+    _connections.segment_received(tuple, seg);
+
+    timer = _syn_queue.find(tuple);
+    if (timer == nullptr) {
+        return;
+    }
+    TCPConnection *conn = _connections.find(tuple);
+    // a connection whose SYN carried Fast Open data can be used before its handshake completes
+    const bool established =
+        conn != nullptr and (conn->handshake_complete() or not conn->inbound_stream().buffer_empty());
+    if (established or conn == nullptr or not conn->active()) {
+        _syn_timers.cancel(*timer);
+        _syn_queue.erase(tuple);
+        if (established) {
+            _accept_queue.push(tuple);
+        }
+    }
+}
+
+void TCPListener::tick(const size_t ms_since_last_tick) {
+    _connections.tick(ms_since_last_tick);
+    _syn_timers.advance(ms_since_last_tick);
+}
+
+//! \details A connection that was reset or finished while it waited is skipped.
+optional<FourTuple> TCPListener::accept() {
+    while (not _accept_queue.empty()) {
+        const FourTuple tuple = _accept_queue.front();
+        _accept_queue.pop();
+        const TCPConnection *conn = _connections.find(tuple);
+        if (conn != nullptr and conn->active()) {
+            return tuple;
+        }
+    }
+    return {};
+}
@@ -0,0 +1,117 @@
+#ifndef SPONGE_LIBSPONGE_TCP_LISTENER_HH
+#define SPONGE_LIBSPONGE_TCP_LISTENER_HH
+
+#include "connection_table.hh"
+#include "isn_generator.hh"
+#include "ring_queue.hh"
+#include "tcp_config.hh"
+#include "tcp_multiplexer.hh"
+#include "tcp_segment.hh"
+#include "timing_wheel.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+//! \brief A listening endpoint that accepts many connections over one adapter
+//! \details A SYN for a new FourTuple starts a half-open connection in the SYN queue. When the
+//! handshake completes, the connection moves to the accept queue, where accept() hands it out.
+//! SYNs that arrive while either queue is full are dropped without a reply, so the peer's SYN
+//! retransmission tries again later; so are ACKs that would complete a handshake while the accept
+//! queue is full. A half-open connection that has not completed within `syn_timeout_ms` is
+//! forgotten. The connections themselves live in a TCPMultiplexer, which the application uses
+//! (through connections()) to read and write accepted connections.
+//!
+//! With SYN cookies on, a SYN that finds the SYN queue full is answered with a SynCookies
+//! SYN/ACK and no state is kept; the connection is created only when a final ACK returns a
+//! valid cookie, so a SYN flood cannot exhaust memory or lock out legitimate clients.
+//!
+//! With TCP Fast Open (TCPConfig::fastopen), a connection whose SYN carried data with a valid
+//! cookie goes to the accept queue at once, so the application can answer within the first RTT.
+class TCPListener {
+  public:
+    static constexpr size_t DEFAULT_SYN_BACKLOG = 1024;
+    static constexpr size_t DEFAULT_ACCEPT_BACKLOG = 128;
+    static constexpr uint64_t DEFAULT_SYN_TIMEOUT_MS = 30000;
+
+  private:
+    TCPConfig _cfg;
+    TCPMultiplexer _connections;
+    size_t _syn_backlog;
+    size_t _accept_backlog;
+    uint64_t _syn_timeout_ms;
+
+    ConnectionTable<TimingWheel::TimerId> _syn_queue{};  //!< Half-open connections and their expiry timers
+    RingQueue<FourTuple> _accept_queue{};                //!< Established connections awaiting accept()
+    TimingWheel _syn_timers{};
+    size_t _syns_dropped = 0;
+    size_t _acks_dropped = 0;
+
+    bool _syn_cookies = false;
+    SynCookies _cookies{};
+    size_t _cookies_sent = 0;
+    size_t _cookies_accepted = 0;
+
+    //! Admit a SYN for a new tuple into the SYN queue, if there is room.
+    //! \returns `false` if the SYN was dropped or answered with a cookie instead
+    bool _admit(const FourTuple &tuple, const TCPSegment &syn);
+
+    //! Answer a SYN with a SYN/ACK whose sequence number is a cookie.
+    void _send_cookie(const FourTuple &tuple, const TCPSegment &syn);
+
+    //! Create the connection for an ACK that returns a valid cookie.
+    //! \returns `false` if the ACK does not carry a valid cookie
+    bool _accept_cookie(const FourTuple &tuple, const TCPSegment &ack);
+
+    //! The tuple's timestamp clock: SynCookies::ts_offset() plus the listener's time.
+    uint32_t _ts_value(const FourTuple &tuple) const;
+
+    void _syn_expired(const FourTuple &tuple);
+
+  public:
+    //! \param[in] cfg is the configuration of every accepted connection
+    //! \param[in] syn_backlog bounds the number of half-open connections
+    //! \param[in] accept_backlog bounds the number of established connections waiting for accept()
+    //! \param[in] syn_timeout_ms is how long a half-open connection may take to complete its handshake
+    explicit TCPListener(const TCPConfig &cfg,
+                         const size_t syn_backlog = DEFAULT_SYN_BACKLOG,
+                         const size_t accept_backlog = DEFAULT_ACCEPT_BACKLOG,
+                         const uint64_t syn_timeout_ms = DEFAULT_SYN_TIMEOUT_MS);
+
+    //! \name Not copyable or movable (pending timers refer back to the listener)
+    //!@{
+    TCPListener(const TCPListener &other) = delete;
+    TCPListener &operator=(const TCPListener &other) = delete;
+    //!@}
+
+    //! \brief Answer SYNs with cookies when the SYN queue is full (instead of dropping them)?
+    void set_syn_cookies(const bool enabled) { _syn_cookies = enabled; }
+
+    //! \brief Dispatch a segment that arrived for `tuple`
+    void segment_received(const FourTuple &tuple, const TCPSegment &seg);
+
+    //! \brief Let time pass, for the connections and for the SYN queue
+    void tick(const size_t ms_since_last_tick);
+
+    //! \brief Take the oldest established connection off the accept queue
+    //! \returns its FourTuple (use connections() to reach it), or empty if none is waiting
+    std::optional<FourTuple> accept();
+
+    //! \brief The multiplexer holding every connection, half-open or accepted
+    TCPMultiplexer &connections() { return _connections; }
+
+    //! \brief Segments to send, each tagged with its connection's FourTuple
+    RingQueue<TCPMultiplexer::TaggedSegment> &segments_out() { return _connections.segments_out(); }
+
+    //! \name Queue statistics
+    //!@{
+    size_t syn_queue_size() const { return _syn_queue.size(); }
+    size_t accept_queue_size() const { return _accept_queue.size(); }
+    size_t syns_dropped() const { return _syns_dropped; }  //!< SYNs dropped because a queue was full
+    size_t acks_dropped() const { return _acks_dropped; }  //!< Handshake ACKs dropped for a full accept queue
+    size_t cookies_sent() const { return _cookies_sent; }
+    size_t cookies_accepted() const { return _cookies_accepted; }  //!< connections created from a cookie
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_LISTENER_HH
@@ -0,0 +1,181 @@
+#include "tcp_multiplexer.hh"
+
+using namespace std;
+
+TCPMultiplexer::Flow &TCPMultiplexer::_add_flow(const FourTuple &tuple,
+                                                const optional<WrappingInt32> isn,
+                                                const optional<uint32_t> ts_offset) {
+    TCPConfig cfg = _cfg;
+    if (isn.has_value()) {
+        cfg.fixed_isn = isn;
+    } else if (not cfg.fixed_isn.has_value()) {
+        cfg.fixed_isn = _isn(tuple);
+    }
+    if (ts_offset.has_value()) {
+        cfg.fixed_ts_offset = ts_offset;
+    }
+    auto inserted = _flows.insert(tuple, make_unique<Flow>(cfg, _wheel.now_ms()));
+    Flow &flow = **inserted.first;
+    if (_cfg.fastopen) {
+        // the cookie a client must present; connect() replaces it with the one cached for the server
+        flow.connection.set_fastopen_cookie(_fastopen_cookies.cookie(tuple.remote_ip));
+    }
+    return flow;
+}
+
+void TCPMultiplexer::_catch_up(Flow &flow) {
+    const uint64_t now = _wheel.now_ms();
+    if (now > flow.last_tick_ms) {
+        flow.connection.tick(now - flow.last_tick_ms);
+        flow.last_tick_ms = now;
+    }
+}
+
+void TCPMultiplexer::_service(const FourTuple &tuple, Flow &flow) {
+    if (_cfg.fastopen) {
+        if (const auto cookie = flow.connection.take_fastopen_cookie()) {
+            _fastopen_cache.insert(tuple.remote_ip, *cookie);
+        }
+    }
+
+    auto &out = flow.connection.segments_out();
+    while (not out.empty()) {
+        _segments_out.emplace(tuple, move(out.front()));
+        out.pop();
+    }
+
+    if (flow.timer.has_value()) {
+        _wheel.cancel(*flow.timer);
+        flow.timer.reset();
+    }
+
+    if (not flow.connection.active()) {
+        if (flow.connection.inbound_stream().buffer_empty()) {
+            _flows.erase(tuple);  // destroys `flow`
+        }
+        return;
+    }
+
+    const auto deadline = flow.connection.time_until_next_deadline();
+    if (deadline.has_value()) {
+        flow.timer = _wheel.schedule(*deadline, [this, tuple] { _timer_expired(tuple); });
+    }
+}
+
+void TCPMultiplexer::_timer_expired(const FourTuple &tuple) {
+    auto flow = _flows.find(tuple);
+    if (flow == nullptr) {
+        return;
+    }
+    (*flow)->timer.reset();
+    _catch_up(**flow);
+    _service(tuple, **flow);
+}
+
+//! \details As in the CLOSED state of RFC 793, anything but a RST is answered with a RST that the
+//! sender will accept, so that a peer still retransmitting to a connection we have dropped gives up.
+void TCPMultiplexer::_reset(const FourTuple &tuple, const TCPSegment &seg) {
+    if (seg.header().rst) {
+        return;
+    }
+    TCPSegment rst;
+    rst.header().rst = true;
+    if (seg.header().ack) {
+        rst.header().seqno = seg.header().ackno;
+    } else {
+        rst.header().ack = true;
+        rst.header().ackno = seg.header().seqno + seg.length_in_sequence_space();
+    }
+    _segments_out.emplace(tuple, move(rst));
+}
+
+TCPConnection &TCPMultiplexer::connect(const FourTuple &tuple, const string &data) {
+    auto existing = _flows.find(tuple);
+    if (existing != nullptr) {
+        return (*existing)->connection;
+    }
+    Flow &flow = _add_flow(tuple);
+    if (_cfg.fastopen) {
+        const auto cookie = _fastopen_cache.find(tuple.remote_ip);
+        flow.connection.set_fastopen_cookie(cookie.value_or(TCPHeader::FastOpenCookie{}));
+    }
+    if (data.empty()) {
+        flow.connection.connect();
+    } else {
+        flow.connection.write(data);  // sends the SYN, with as much of `data` as Fast Open allows
+    }
+    _service(tuple, flow);
+    return flow.connection;
+}
+
+TCPConnection &TCPMultiplexer::listen(const FourTuple &tuple,
+                                      const optional<WrappingInt32> isn,
+                                      const optional<uint32_t> ts_offset) {
+    auto existing = _flows.find(tuple);
+    return existing != nullptr ? (*existing)->connection : _add_flow(tuple, isn, ts_offset).connection;
+}
+
+void TCPMultiplexer::drop(const FourTuple &tuple) {
+    auto flow = _flows.find(tuple);
+    if (flow == nullptr) {
+        return;
+    }
+    if ((*flow)->timer.has_value()) {
+        _wheel.cancel(*(*flow)->timer);
+    }
+    // the RST that an active connection queues as it is destroyed goes nowhere
+    _flows.erase(tuple);
+}
+
+TCPConnection *TCPMultiplexer::find(const FourTuple &tuple) {
+    auto flow = _flows.find(tuple);
+    return flow == nullptr ? nullptr : &(*flow)->connection;
+}
+
+size_t TCPMultiplexer::write(const FourTuple &tuple, const string &data) {
+    auto flow = _flows.find(tuple);
+    if (flow == nullptr) {
+        return 0;
+    }
+    _catch_up(**flow);
+    const size_t written = (*flow)->connection.write(data);
+    _service(tuple, **flow);
+    return written;
+}
+
+void TCPMultiplexer::end_input_stream(const FourTuple &tuple) {
+    auto flow = _flows.find(tuple);
+    if (flow == nullptr) {
+        return;
+    }
+    _catch_up(**flow);
+    (*flow)->connection.end_input_stream();
+    _service(tuple, **flow);
+}
+
+void TCPMultiplexer::flush(const FourTuple &tuple) {
+    auto flow = _flows.find(tuple);
+    if (flow != nullptr) {
+        (*flow)->connection.inbound_stream_read();
+        _service(tuple, **flow);
+    }
+}
+
+void TCPMultiplexer::segment_received(const FourTuple &tuple, const TCPSegment &seg) {
+    auto existing = _flows.find(tuple);
+    Flow *flow = existing == nullptr ? nullptr : existing->get();
+    if (flow == nullptr) {
+        const TCPHeader &header = seg.header();
+        if (not _listening or not header.syn or header.ack or header.rst) {
+            _reset(tuple, seg);
+            return;
+        }
+        flow = &_add_flow(tuple);
+    }
+
+    _catch_up(*flow);
+    flow->connection.segment_received(seg);
+    _service(tuple, *flow);
+}
+
+void TCPMultiplexer::tick(const size_t ms_since_last_tick) { _wheel.advance(ms_since_last_tick); }
@@ -0,0 +1,135 @@
+#ifndef SPONGE_LIBSPONGE_TCP_MULTIPLEXER_HH
+#define SPONGE_LIBSPONGE_TCP_MULTIPLEXER_HH
+
+#include "connection_table.hh"
+#include "fastopen.hh"
+#include "isn_generator.hh"
+#include "ring_queue.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "timing_wheel.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+//! \brief Many TCPConnection%s sharing one datagram adapter and one thread
+//! \details Incoming segments are dispatched by their FourTuple through a ConnectionTable, and
+//! outgoing segments are tagged with the FourTuple of the connection that sent them. Instead of
+//! ticking every connection, the multiplexer keeps one TimingWheel timer per connection at its
+//! TCPConnection::time_until_next_deadline(); a connection's clock is brought up to date when
+//! its timer fires or a segment arrives for it, so idle connections cost nothing per tick.
+//!
+//! Unless the configuration fixes the ISN, each connection gets its ISN from an IsnGenerator.
+//!
+//! With TCPConfig::fastopen set, passively opened connections get the FastOpenCookies cookie for
+//! the client's address, actively opened ones the cookie cached for the server, and cookies that
+//! servers issue are cached for later connections to them.
+//!
+//! Connections that are no longer active are dropped once their inbound stream has been read
+//! to the end (see flush()).
+class TCPMultiplexer {
+  public:
+    using TaggedSegment = std::pair<FourTuple, TCPSegment>;  //!< A segment and the connection it belongs to
+
+  private:
+    struct Flow {
+        TCPConnection connection;
+        uint64_t last_tick_ms;                         //!< Wheel time that `connection` has been ticked up to
+        std::optional<TimingWheel::TimerId> timer{};  //!< Pending deadline, if any
+
+        Flow(const TCPConfig &cfg, const uint64_t now_ms) : connection(cfg), last_tick_ms(now_ms) {}
+    };
+
+    TCPConfig _cfg;
+    bool _listening = false;
+    ConnectionTable<std::unique_ptr<Flow>> _flows{};
+    TimingWheel _wheel{};
+    RingQueue<TaggedSegment> _segments_out{};
+    IsnGenerator _isn{};
+    FastOpenCookies _fastopen_cookies{};
+    FastOpenCache _fastopen_cache{};
+
+    Flow &_add_flow(const FourTuple &tuple,
+                    const std::optional<WrappingInt32> isn = {},
+                    const std::optional<uint32_t> ts_offset = {});
+
+    //! Tick the connection for the time that passed since it was last ticked.
+    void _catch_up(Flow &flow);
+
+    //! Collect the connection's output, then either re-arm its timer or drop it.
+    void _service(const FourTuple &tuple, Flow &flow);
+
+    void _timer_expired(const FourTuple &tuple);
+
+    //! Answer a segment that belongs to no connection.
+    void _reset(const FourTuple &tuple, const TCPSegment &seg);
+
+  public:
+    explicit TCPMultiplexer(const TCPConfig &cfg) : _cfg(cfg) {}
+
+    //! \name Not copyable or movable (pending timers refer back to the multiplexer)
+    //!@{
+    TCPMultiplexer(const TCPMultiplexer &other) = delete;
+    TCPMultiplexer &operator=(const TCPMultiplexer &other) = delete;
+    //!@}
+
+    //! \brief Should a SYN for an unknown FourTuple create a new (passively opened) connection?
+    void set_listening(const bool listening) { _listening = listening; }
+
+    //! \brief Open a connection to `tuple.remote_*` from `tuple.local_*` and send its SYN
+    //! \param[in] data first bytes to send, on the SYN itself if a Fast Open cookie for the server is cached
+    //! \returns the new connection (or the existing one, if `tuple` is already in use)
+    TCPConnection &connect(const FourTuple &tuple, const std::string &data = {});
+
+    //! \brief Create a connection for `tuple` in LISTEN, to take a SYN that is about to be delivered
+    //! \details For callers that decide themselves which SYNs to accept (see TCPListener).
+    //! \param[in] isn overrides the ISN that the connection would otherwise get
+    //! \param[in] ts_offset overrides the offset of its timestamp clock (see TCPConfig::fixed_ts_offset)
+    TCPConnection &listen(const FourTuple &tuple,
+                          const std::optional<WrappingInt32> isn = {},
+                          const std::optional<uint32_t> ts_offset = {});
+
+    //! \brief Forget the connection for `tuple` without sending anything to the peer
+    void drop(const FourTuple &tuple);
+
+    //! \returns the connection for `tuple`, or `nullptr` if there is none
+    //! \note After calling a method of the connection directly, call flush() to send its output.
+    TCPConnection *find(const FourTuple &tuple);
+
+    //! \brief Write to the outbound stream of the connection for `tuple`
+    //! \returns the number of bytes accepted (0 if there is no such connection)
+    size_t write(const FourTuple &tuple, const std::string &data);
+
+    //! \brief End the outbound stream of the connection for `tuple`
+    void end_input_stream(const FourTuple &tuple);
+
+    //! \brief Collect output from the connection for `tuple` after it was used directly
+    //! \details Sends a window update if the inbound stream has been read far enough (see
+    //! TCPConnection::inbound_stream_read()), and drops the connection if it is finished and its
+    //! inbound stream has been read.
+    void flush(const FourTuple &tuple);
+
+    //! \brief Dispatch a segment that arrived for `tuple`
+    //! \details A SYN for an unknown tuple creates a connection when listening; other segments
+    //! for unknown tuples are answered with a RST.
+    void segment_received(const FourTuple &tuple, const TCPSegment &seg);
+
+    //! \brief Let time pass, ticking only the connections whose deadlines expire
+    void tick(const size_t ms_since_last_tick);
+
+    //! \brief Segments to send, each tagged with its connection's FourTuple
+    RingQueue<TaggedSegment> &segments_out() { return _segments_out; }
+
+    //! \brief Number of connections in the table
+    size_t size() const { return _flows.size(); }
+
+    //! \brief Fast Open cookies received from servers
+    FastOpenCache &fastopen_cache() { return _fastopen_cache; }
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_MULTIPLEXER_HH
@@ -24,14 +24,16 @@ using namespace std;
 //! from the TCP header; it uses this information to filter future reads.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram &ip_dgram) {
+    const Configured &ours = configured();
+
     // is the IPv4 datagram for us?
     // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
-    if (not listening() and (ip_dgram.header().dst != config().source.ipv4_numeric())) {
+    if (not listening() and (ip_dgram.header().dst != ours.tuple.local_ip)) {
         return {};
     }
 
     // is the IPv4 datagram from our peer?
-    if (not listening() and (ip_dgram.header().src != config().destination.ipv4_numeric())) {
+    if (not listening() and (ip_dgram.header().src != ours.tuple.remote_ip)) {
         return {};
     }
 
@@ -40,21 +42,28 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
         return {};
     }
 
-    // is the payload a valid TCP segment?
-    TCPSegment tcp_seg;
-    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+    // are its ports ours? (checked before the segment is parsed, so that others' segments are never summed)
+    const Buffer payload = ip_dgram.payload();
+    NetParser ports{payload};
+    const uint16_t sport = ports.u16();
+    const uint16_t dport = ports.u16();
+    if (ports.error() or dport != ours.tuple.local_port or (not listening() and sport != ours.tuple.remote_port)) {
         return {};
     }
 
-    // is the TCP segment for us?
-    if (tcp_seg.header().dport != config().source.port()) {
+    // is the payload a valid TCP segment?
+    const uint32_t pseudo_cksum = listening() ? ip_dgram.header().pseudo_cksum()
+                                              : ours.pseudo_partial + ip_dgram.header().payload_length();
+    TCPSegment tcp_seg;
+    if (ParseResult::NoError != tcp_seg.parse(payload, pseudo_cksum)) {
         return {};
     }
+    tcp_seg.set_ecn(ip_dgram.header().tos & IPv4Header::ECN_MASK);
 
     // should we target this source addr/port (and use its destination addr as our source) in reply?
     if (listening()) {
         if (tcp_seg.header().syn and not tcp_seg.header().rst) {
-            config_mutable().source = {inet_ntoa({htobe32(ip_dgram.header().dst)}), config().source.port()};
+            config_mutable().source = {inet_ntoa({htobe32(ip_dgram.header().dst)}), dport};
             config_mutable().destination = {inet_ntoa({htobe32(ip_dgram.header().src)}), tcp_seg.header().sport};
             set_listening(false);
         } else {
@@ -62,29 +71,124 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
         }
     }
 
-    // is the TCP segment from our peer?
-    if (tcp_seg.header().sport != config().destination.port()) {
-        return {};
+    return tcp_seg;
+}
+
+//! \details Address::port() formats the port with getnameinfo() and parses it back with stoi(), and the
+//! pseudo-header sum costs a pass over both addresses, so the connection is read from the configuration once
+//! and kept until config_mut() or config_mutable() hands it out again.
+const TCPOverIPv4Adapter::Configured &TCPOverIPv4Adapter::configured() {
+    if (not _configured.has_value()) {
+        const FourTuple tuple{config().source.ipv4_numeric(),
+                              config().source.port(),
+                              config().destination.ipv4_numeric(),
+                              config().destination.port()};
+        IPv4Header header;
+        header.src = tuple.local_ip;
+        header.dst = tuple.remote_ip;
+        _configured = Configured{tuple, header.pseudo_cksum_partial()};
     }
+    return _configured.value();
+}
 
-    return tcp_seg;
+FdAdapterConfig &TCPOverIPv4Adapter::config_mutable() {
+    _configured.reset();
+    return FdAdapterBase::config_mutable();
+}
+
+FdAdapterConfig &TCPOverIPv4Adapter::config_mut() {
+    _configured.reset();
+    return FdAdapterBase::config_mut();
 }
 
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+    return wrap_tcp_in_ip(configured_tuple(), seg);
+}
+
+//! \param[in] seg is the TCP segment to convert
+BufferList TCPOverIPv4Adapter::serialize_tcp_in_ip(TCPSegment &seg) {
+    const Configured &ours = configured();
+    return serialize_tcp_in_ip(ours.tuple, seg, ours.pseudo_partial);
+}
+
+//! \param[in] seg is the pure ACK to convert
+string_view TCPOverIPv4Adapter::serialize_ack(TCPSegment &seg) {
+    return _ack_template.serialize(configured_tuple(), seg);
+}
+
+//! \details Unlike unwrap_tcp_in_ip(), this accepts a TCP segment from any peer to any port, as long
+//! as it is addressed to the configured source address (or the source address is INADDR_ANY).
+//! \returns the segment and the FourTuple of its connection, or empty if the datagram is not for us
+optional<pair<FourTuple, TCPSegment>> TCPOverIPv4Adapter::unwrap_any_tcp_in_ip(const InternetDatagram &ip_dgram) const {
+    const uint32_t local_ip = config().source.ipv4_numeric();
+    if (local_ip != 0 and ip_dgram.header().dst != local_ip) {
+        return {};
+    }
+
+    if (ip_dgram.header().proto != IPv4Header::PROTO_TCP) {
+        return {};
+    }
+
+    TCPSegment tcp_seg;
+    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+        return {};
+    }
+    tcp_seg.set_ecn(ip_dgram.header().tos & IPv4Header::ECN_MASK);
+
+    const FourTuple tuple{
+        ip_dgram.header().dst, tcp_seg.header().dport, ip_dgram.header().src, tcp_seg.header().sport};
+    return {{tuple, move(tcp_seg)}};
+}
+
+IPv4Header TCPOverIPv4Adapter::ip_header_for(const FourTuple &tuple, TCPSegment &seg) {
     // set the port numbers in the TCP segment
-    seg.header().sport = config().source.port();
-    seg.header().dport = config().destination.port();
+    seg.header().sport = tuple.local_port;
+    seg.header().dport = tuple.remote_port;
+
+    // set the datagram's addresses and length
+    IPv4Header header;
+    header.src = tuple.local_ip;
+    header.dst = tuple.remote_ip;
+    header.tos = seg.ecn();
+    header.len = header.hlen * 4 + seg.header().serialized_length() + seg.payload().size();
+    return header;
+}
 
-    // create an Internet Datagram and set its addresses and length
+//! \param[in] tuple gives the addresses and ports of the datagram and segment
+//! \param[in] seg is the TCP segment to convert
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg) {
+    // create an Internet Datagram
     InternetDatagram ip_dgram;
-    ip_dgram.header().src = config().source.ipv4_numeric();
-    ip_dgram.header().dst = config().destination.ipv4_numeric();
-    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    ip_dgram.header() = ip_header_for(tuple, seg);
 
     // set payload, calculating TCP checksum using information from IP header
     ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
 
     return ip_dgram;
 }
+
+//! \details The TCP header is written at the back of a single headroom sized for both headers, and the
+//! IPv4 header in front of it; the payload follows as its own Buffer, uncopied.
+//! \param[in] tuple gives the addresses and ports of the datagram and segment
+//! \param[in] seg is the TCP segment to convert
+BufferList TCPOverIPv4Adapter::serialize_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg) {
+    IPv4Header header;
+    header.src = tuple.local_ip;
+    header.dst = tuple.remote_ip;
+    return serialize_tcp_in_ip(tuple, seg, header.pseudo_cksum_partial());
+}
+
+BufferList TCPOverIPv4Adapter::serialize_tcp_in_ip(const FourTuple &tuple,
+                                                   TCPSegment &seg,
+                                                   const uint32_t pseudo_partial) {
+    const IPv4Header header = ip_header_for(tuple, seg);
+    Headroom headroom{header.hlen * 4 + seg.header().serialized_length()};
+    seg.prepend_header_to(headroom, pseudo_partial + header.payload_length());
+    header.prepend_to(headroom);
+
+    BufferList ret{move(headroom).release()};
+    ret.append(seg.payload());
+    return ret;
+}
@@ -1,19 +1,68 @@
 #ifndef SPONGE_LIBSPONGE_TCP_OVER_IP_HH
 #define SPONGE_LIBSPONGE_TCP_OVER_IP_HH
 
+#include "ack_template.hh"
 #include "buffer.hh"
+#include "connection_table.hh"
 #include "fd_adapter.hh"
 #include "ipv4_datagram.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <string_view>
+#include <utility>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
+  private:
+    //! The configured connection as numbers, kept until the configuration may change
+    struct Configured {
+        FourTuple tuple;
+        uint32_t pseudo_partial;  //!< IPv4Header::pseudo_cksum_partial() for the connection's addresses
+    };
+    std::optional<Configured> _configured{};
+
+    AckTemplate _ack_template{};  //!< Serializes the connection's pure ACKs (see serialize_ack())
+
+    //! The configured connection, rebuilt from the configuration when it was dropped
+    const Configured &configured();
+
+    //! The IPv4 header for `seg`, whose ports are set from `tuple`
+    static IPv4Header ip_header_for(const FourTuple &tuple, TCPSegment &seg);
+
+    //! serialize_tcp_in_ip() with the pseudo-header sum, less the length, already known
+    static BufferList serialize_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg, const uint32_t pseudo_partial);
+
+  protected:
+    //! The addresses and ports of the configured connection, kept until the configuration changes
+    const FourTuple &configured_tuple() { return configured().tuple; }
+
+    //! FdAdapterBase::config_mutable(), which also drops what is kept from the configuration
+    FdAdapterConfig &config_mutable();
+
   public:
+    //! FdAdapterBase::config_mut(), which also drops what is kept from the configuration
+    FdAdapterConfig &config_mut();
+
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! \brief The datagram wrap_tcp_in_ip() would make, serialized with both headers in one allocation
+    BufferList serialize_tcp_in_ip(TCPSegment &seg);
+
+    //! \brief The datagram for `seg`, a pure ACK that AckTemplate::fits(), patched into the connection's template
+    //! \returns the datagram, valid until the next call
+    std::string_view serialize_ack(TCPSegment &seg);
+
+    //! \name Interface for serving many connections (see TCPMultiplexer)
+    //!@{
+    std::optional<std::pair<FourTuple, TCPSegment>> unwrap_any_tcp_in_ip(const InternetDatagram &ip_dgram) const;
+
+    static InternetDatagram wrap_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg);
+
+    static BufferList serialize_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg);
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
@@ -7,6 +7,9 @@
 
 using namespace std;
 
+//! Where the checksum sits in a serialized TCP header
+static constexpr size_t CKSUM_OFFSET = 16;
+
 //! \param[in] buffer string/Buffer to be parsed
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
 ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer_checksum) {
@@ -19,6 +22,7 @@ ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer
     NetParser p{buffer};
     _header.parse(p);
     _payload = p.buffer();
+    _payload_sum = 0;
     return p.get_error();
 }
 
@@ -37,20 +41,75 @@ size_t TCPSegment::length_in_sequence_space() const {
     return payload().str().size() + (header().syn ? 1 : 0) + (header().fin ? 1 : 0);
 }
 
+//! \param[in] mss largest payload per piece (must be positive)
+vector<TCPSegment> TCPSegment::split(const size_t mss) const {
+    const size_t size = _payload.size();
+    if (mss == 0 or size <= mss) {
+        return {*this};
+    }
+
+    vector<TCPSegment> pieces;
+    pieces.reserve((size + mss - 1) / mss);
+    for (size_t offset = 0; offset < size; offset += mss) {
+        const bool first = offset == 0;
+        const bool last = offset + mss >= size;
+
+        TCPSegment piece;
+        piece._header = _header;
+        piece._header.syn = first and _header.syn;
+        piece._header.cwr = first and _header.cwr;
+        piece._header.fin = last and _header.fin;
+        piece._header.psh = last and _header.psh;
+        // the SYN occupies the sequence number just before the first payload byte
+        piece._header.seqno = _header.seqno + (first ? 0 : static_cast<uint32_t>(offset + (_header.syn ? 1 : 0)));
+        piece._payload = _payload.substr(offset, mss);  // shares the super-segment's storage
+        piece._ecn = _ecn;
+        pieces.push_back(move(piece));
+    }
+    return pieces;
+}
+
+//! The payload's sum as cached: ones'-complement zero is kept as 0xffff, so that 0 can mean "not computed"
+static uint16_t cached_sum(const InternetChecksum &check) {
+    const uint16_t sum = ~check.value();
+    return sum == 0 ? 0xffff : sum;
+}
+
+uint16_t TCPSegment::payload_sum() const {
+    if (_payload_sum == 0 and _payload.size() > 0) {
+        InternetChecksum check;
+        check.add(_payload);
+        _payload_sum = cached_sum(check);
+    }
+    return _payload_sum;
+}
+
+void TCPSegment::set_payload(Buffer payload, const InternetChecksum &check) {
+    _payload = move(payload);
+    _payload_sum = _payload.size() > 0 ? cached_sum(check) : 0;
+}
+
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
+    Headroom headroom{_header.serialized_length()};
+    prepend_header_to(headroom, datagram_layer_checksum);
+    BufferList ret{move(headroom).release()};
+    ret.append(_payload);
+    return ret;
+}
+
+//! \param[in,out] headroom gets the header in front of any headers already in it
+//! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+void TCPSegment::prepend_header_to(Headroom &headroom, const uint32_t datagram_layer_checksum) const {
+    const size_t length = _header.serialized_length();
+    char *const dest = headroom.prepend(length);
     TCPHeader header_out = _header;
     header_out.cksum = 0;
+    header_out.serialize(dest, length);
 
-    // calculate checksum -- taken over entire segment
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
-    check.add(_payload);
-    header_out.cksum = check.value();
-
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
-
-    return ret;
+    // calculate checksum -- taken over entire segment; the header's length is a multiple of four, so the
+    // payload's words line up with the ones summed in payload_sum()
+    InternetChecksum check(datagram_layer_checksum + payload_sum());
+    check.add({dest, length});
+    NetUnparser::u16(dest + CKSUM_OFFSET, check.value());
 }
@@ -5,11 +5,27 @@
 #include "tcp_header.hh"
 
 #include <cstdint>
+#include <utility>
+#include <vector>
+
+class InternetChecksum;
 
 //! \brief [TCP](\ref rfc::rfc793) segment
 class TCPSegment {
+  public:
+    //! \name ECN codepoints (RFC 3168 section 5): the low two bits of the IP type-of-service byte
+    //!@{
+    static constexpr uint8_t ECN_NOT_ECT = 0b00;  //!< Not ECN-capable
+    static constexpr uint8_t ECN_ECT1 = 0b01;     //!< ECN-capable transport, ECT(1)
+    static constexpr uint8_t ECN_ECT0 = 0b10;     //!< ECN-capable transport, ECT(0)
+    static constexpr uint8_t ECN_CE = 0b11;       //!< Congestion experienced
+    //!@}
+
   private:
     TCPHeader _header{};
+    uint8_t _ecn = ECN_NOT_ECT;
+    //! Cached payload_sum(), or 0 if not computed yet (a sum of zero is kept as 0xffff, its other form)
+    mutable uint16_t _payload_sum = 0;
     Buffer _payload{};
 
   public:
@@ -19,13 +35,42 @@ class TCPSegment {
     //! \brief Serialize the segment to a string
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
 
+    //! \brief Prepend the header, with its checksum, to `headroom`; the payload goes after it unchanged
+    void prepend_header_to(Headroom &headroom, const uint32_t datagram_layer_checksum = 0) const;
+
     //! \name Accessors
     //!@{
     const TCPHeader &header() const { return _header; }
     TCPHeader &header() { return _header; }
 
     const Buffer &payload() const { return _payload; }
-    Buffer &payload() { return _payload; }
+
+    //! \brief Replace the payload (dropping its cached payload_sum())
+    void set_payload(Buffer payload) {
+        _payload = std::move(payload);
+        _payload_sum = 0;
+    }
+
+    //! \brief The payload, to change in place (dropping its cached payload_sum())
+    Buffer &mutable_payload() {
+        _payload_sum = 0;
+        return _payload;
+    }
+
+    //! \brief Ones'-complement sum of the payload, as it goes into the checksum
+    //! \details Computed on first use and kept (in copies of the segment, too) until the payload is
+    //! changed through set_payload() or mutable_payload(), so that serialize() only sums the header
+    //! when a segment is sent again, e.g. retransmitted or with a new ackno and window.
+    uint16_t payload_sum() const;
+
+    //! \brief Set the payload together with its sum, already taken in `check` (which started from zero
+    //! and saw exactly these bytes) while the payload was copied, e.g. by ByteStream::read()
+    void set_payload(Buffer payload, const InternetChecksum &check);
+
+    //! \brief ECN codepoint of the datagram that carries (or carried) the segment; not part of the
+    //! segment itself, but set and read by the adapter that wraps it (e.g. in the IPv4 TOS byte)
+    uint8_t ecn() const { return _ecn; }
+    void set_ecn(const uint8_t ecn) { _ecn = ecn; }
 
     std::string str() const;
 
@@ -34,6 +79,11 @@ class TCPSegment {
     //! \brief Segment's length in sequence space
     //! \note Equal to payload length plus one byte if SYN is set, plus one byte if FIN is set
     size_t length_in_sequence_space() const;
+
+    //! \brief Cut the segment into pieces carrying at most `mss` bytes of payload each
+    //! \details The first piece keeps SYN and CWR, the last keeps FIN and PSH; every piece keeps ACK, RST,
+    //! ECE, the ECN codepoint, the window and the ackno, and its seqno is advanced by the payload that precedes it.
+    std::vector<TCPSegment> split(const size_t mss) const;
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_SEGMENT_HH
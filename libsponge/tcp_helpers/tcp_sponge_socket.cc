@@ -5,9 +5,11 @@
 #include "tun.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <exception>
 #include <iostream>
+#include <poll.h>
 #include <stdexcept>
 #include <string>
 #include <sys/socket.h>
@@ -15,30 +17,67 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <utility>
+#include <vector>
 
 using namespace std;
 
-static constexpr size_t TCP_TICK_MS = 10;
+//! Longest the loop sleeps when the TCPConnection has no timer running; keeps the adapter's own timers
+//! (e.g. ARP) ticking. An `_abort` wakes the loop at once through `_abort_wakeup`.
+static constexpr size_t TCP_MAX_SLEEP_MS = 1000;
+
+//! Most datagrams handed to the TCPConnection in one batch; bounds how long the other rules wait
+static constexpr size_t TCP_MAX_BATCH = 64;
+
+//! \returns true if a read from `fd` would not block
+static bool readable(const FileDescriptor &fd) {
+    pollfd pfd{fd.fd_num(), POLLIN, 0};
+    return SystemCall("poll", ::poll(&pfd, 1, 0)) > 0 and (pfd.revents & POLLIN);
+}
 
 //! \param[in] condition is a function returning true if loop should continue
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
     auto base_time = timestamp_ms();
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        // sleep until the connection's next deadline instead of polling every few milliseconds
+        size_t timeout_ms = TCP_MAX_SLEEP_MS;
+        if (_tcp.value().active()) {
+            timeout_ms = min(timeout_ms, _tcp.value().time_until_next_deadline().value_or(TCP_MAX_SLEEP_MS));
+        }
+        auto ret = _eventloop.wait_next_event(static_cast<int>(timeout_ms));
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
 
         if (_tcp.value().active()) {
             const auto next_time = timestamp_ms();
-            _tcp.value().tick(next_time - base_time);
+            {
+                const lock_guard<mutex> lock{_tcp_mutex};
+                _tcp.value().tick(next_time - base_time);
+            }
             _datagram_adapter.tick(next_time - base_time);
             base_time = next_time;
         }
     }
 }
 
+//! \details Built on request rather than after every event, so the TCPConnection thread only pays for the
+//! lock around the calls that change the connection.
+template <typename AdaptT>
+TCPConnectionStats TCPSpongeSocket<AdaptT>::stats() const {
+    const lock_guard<mutex> lock{_tcp_mutex};
+    return _tcp.has_value() ? _tcp->stats() : _stats;
+}
+
+//! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
+//! \param[in] type is the type of AF_UNIX sockets to create (e.g., SOCK_SEQPACKET)
+//! \returns a std::pair of connected sockets
+static inline pair<FileDescriptor, FileDescriptor> socket_pair_helper(const int type) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, type, 0, static_cast<int *>(fds)));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
 template <typename AdaptT>
@@ -46,7 +85,8 @@ TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> da
                                          AdaptT &&datagram_interface)
     : LocalStreamSocket(move(data_socket_pair.first))
     , _thread_data(move(data_socket_pair.second))
-    , _datagram_adapter(move(datagram_interface)) {
+    , _datagram_adapter(move(datagram_interface))
+    , _abort_wakeup(socket_pair_helper(SOCK_DGRAM)) {
     _thread_data.set_blocking(false);
 }
 
@@ -72,13 +112,25 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     // 4) Outbound segment generated by TCP (needs to be
     //    given to underlying datagram socket)
 
+    // rule 0: the owner is aborting; _tcp_loop() sees `_abort` once the wakeup is consumed
+    _eventloop.add_rule(
+        _abort_wakeup.first, Direction::In, [&] { _abort_wakeup.first.read(); }, [&] { return _tcp->active(); });
+
     // rule 1: read from filtered packet stream and dump into TCPConnection
     _eventloop.add_rule(_datagram_adapter,
                         Direction::In,
                         [&] {
-                            auto seg = _datagram_adapter.read();
-                            if (seg) {
-                                _tcp->segment_received(move(seg.value()));
+                            // drain what has already arrived, so the connection replies once per wakeup
+                            vector<TCPSegment> segs;
+                            do {
+                                auto seg = _datagram_adapter.read();
+                                if (seg) {
+                                    segs.push_back(move(seg.value()));
+                                }
+                            } while (segs.size() < TCP_MAX_BATCH and readable(_datagram_adapter));
+                            if (not segs.empty()) {
+                                const lock_guard<mutex> lock{_tcp_mutex};
+                                _tcp->segments_received(segs);
                             }
 
                             // debugging output:
@@ -96,6 +148,7 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
         _thread_data,
         Direction::In,
         [&] {
+            const lock_guard<mutex> lock{_tcp_mutex};
             const auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
             const auto len = data.size();
             const auto amount_written = _tcp->write(move(data));
@@ -115,6 +168,7 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
         },
         [&] { return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->remaining_outbound_capacity() > 0); },
         [&] {
+            const lock_guard<mutex> lock{_tcp_mutex};
             _tcp->end_input_stream();
             _outbound_shutdown = true;
         });
@@ -124,6 +178,7 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
         _thread_data,
         Direction::Out,
         [&] {
+            const lock_guard<mutex> lock{_tcp_mutex};
             ByteStream &inbound = _tcp->inbound_stream();
             // Write from the inbound_stream into
             // the pipe, handling the possibility of a partial
@@ -132,6 +187,7 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
             const std::string buffer = inbound.peek_output(amount_to_write);
             const auto bytes_written = _thread_data.write(move(buffer), false);
             inbound.pop_output(bytes_written);
+            _tcp->inbound_stream_read();
 
             if (inbound.eof() or inbound.error()) {
                 _thread_data.shutdown(SHUT_WR);
@@ -154,6 +210,7 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     _eventloop.add_rule(_datagram_adapter,
                         Direction::Out,
                         [&] {
+                            const lock_guard<mutex> lock{_tcp_mutex};
                             while (not _tcp->segments_out().empty()) {
                                 _datagram_adapter.write(_tcp->segments_out().front());
                                 _tcp->segments_out().pop();
@@ -162,15 +219,6 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                         [&] { return not _tcp->segments_out().empty(); });
 }
 
-//! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
-//! \param[in] type is the type of AF_UNIX sockets to create (e.g., SOCK_SEQPACKET)
-//! \returns a std::pair of connected sockets
-static inline pair<FileDescriptor, FileDescriptor> socket_pair_helper(const int type) {
-    int fds[2];
-    SystemCall("socketpair", ::socketpair(AF_UNIX, type, 0, static_cast<int *>(fds)));
-    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
-}
-
 //! \param[in] datagram_interface is the underlying interface (e.g. to UDP, IP, or Ethernet)
 template <typename AdaptT>
 TCPSpongeSocket<AdaptT>::TCPSpongeSocket(AdaptT &&datagram_interface)
@@ -183,6 +231,7 @@ TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
             cerr << "Warning: unclean shutdown of TCPSpongeSocket\n";
             // force the other side to exit
             _abort.store(true);
+            _abort_wakeup.second.write("!");
             _tcp_thread.join();
         }
     } catch (const exception &e) {
@@ -263,6 +312,8 @@ void TCPSpongeSocket<AdaptT>::_tcp_main() {
             cerr << "DEBUG: TCP connection finished "
                  << (_tcp.value().state() == TCPState::State::RESET ? "uncleanly" : "cleanly.\n");
         }
+        const lock_guard<mutex> lock{_tcp_mutex};
+        _stats = _tcp.value().stats();
         _tcp.reset();
     } catch (const exception &e) {
         cerr << "Exception in TCPConnection runner thread: " << e.what() << "\n";
@@ -12,6 +12,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <optional>
 #include <thread>
 #include <vector>
@@ -51,12 +52,20 @@ class TCPSpongeSocket : public LocalStreamSocket {
 
     std::atomic_bool _abort{false};  //!< Flag used by the owner to force the TCPConnection thread to shut down
 
+    //! Datagram socket pair; the owner writes to `second` after setting `_abort`, so that the TCPConnection
+    //! thread wakes up at once instead of at the end of its sleep
+    std::pair<FileDescriptor, FileDescriptor> _abort_wakeup;
+
     bool _inbound_shutdown{false};  //!< Has TCPSpongeSocket shut down the incoming data to the owner?
 
     bool _outbound_shutdown{false};  //!< Has the owner shut down the outbound data to the TCP connection?
 
     bool _fully_acked{false};  //!< Has the outbound data been fully acknowledged by the peer?
 
+    //! Held by the TCPConnection thread while it changes `_tcp`, and by stats() while it reads it
+    mutable std::mutex _tcp_mutex{};
+    TCPConnectionStats _stats{};  //!< Final TCPConnection::stats(), kept once the connection is gone
+
   public:
     //! Construct from the interface that the TCPConnection thread will use to read and write datagrams
     explicit TCPSpongeSocket(AdaptT &&datagram_interface);
@@ -72,6 +81,11 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Listen and accept using the specified configurations; blocks until accept succeeds or fails
     void listen_and_accept(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad);
 
+    //! \brief The connection's counters and estimates, as of the TCPConnection thread's last event
+    //! \details Safe to call from the owner thread at any time; after the connection is gone,
+    //! returns its final snapshot.
+    TCPConnectionStats stats() const;
+
     //! When a connected socket is destructed, it will send a RST
     ~TCPSpongeSocket();
 
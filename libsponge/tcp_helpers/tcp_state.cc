@@ -14,6 +14,15 @@ string TCPState::name() const {
            ", linger_after_streams_finish=" + to_string(_linger_after_streams_finish);
 }
 
+optional<TCPState::State> TCPState::official_state() const {
+    for (auto state = static_cast<int>(State::LISTEN); state <= static_cast<int>(State::RESET); state++) {
+        if (*this == TCPState{static_cast<State>(state)}) {
+            return static_cast<State>(state);
+        }
+    }
+    return {};
+}
+
 TCPState::TCPState(const TCPState::State state) {
     switch (state) {
         case TCPState::State::LISTEN:
@@ -4,6 +4,7 @@
 #include "tcp_receiver.hh"
 #include "tcp_sender.hh"
 
+#include <optional>
 #include <string>
 
 //! \brief Summary of a TCPConnection's internal state
@@ -50,6 +51,10 @@ class TCPState {
     //! \brief Summarize the TCPState in a string
     std::string name() const;
 
+    //! \brief The official state that this one matches
+    //! \returns empty if it matches none of them
+    std::optional<State> official_state() const;
+
     //! \brief Construct a TCPState given a sender, a receiver, and the TCPConnection's active and linger bits
     TCPState(const TCPSender &sender, const TCPReceiver &receiver, const bool active, const bool linger);
 
@@ -28,7 +28,40 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     }
 
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    //! \note A segment with more than `config().mss` bytes of payload is split into several datagrams.
+    void write(TCPSegment &seg) {
+        if (AckTemplate::fits(seg)) {
+            _tun.write(serialize_ack(seg));
+            return;
+        }
+        if (seg.payload().size() <= config().mss) {
+            _tun.write(serialize_tcp_in_ip(seg));
+            return;
+        }
+        for (auto &piece : seg.split(config().mss)) {
+            _tun.write(serialize_tcp_in_ip(piece));
+        }
+    }
+
+    //! Reads an IPv4 datagram and returns the TCP segment inside from any peer, with its FourTuple
+    std::optional<std::pair<FourTuple, TCPSegment>> read_any() {
+        InternetDatagram ip_dgram;
+        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
+            return {};
+        }
+        return unwrap_any_tcp_in_ip(ip_dgram);
+    }
+
+    //! Writes a TCP segment of the connection identified by `tuple` to the TUN device
+    void write_to(const FourTuple &tuple, TCPSegment &seg) {
+        if (seg.payload().size() <= config().mss) {
+            _tun.write(serialize_tcp_in_ip(tuple, seg));
+            return;
+        }
+        for (auto &piece : seg.split(config().mss)) {
+            _tun.write(serialize_tcp_in_ip(tuple, piece));
+        }
+    }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
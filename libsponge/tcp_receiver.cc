@@ -2,7 +2,7 @@
 
 #include <cassert>
 
-void TCPReceiver::segment_received(const TCPSegment &seg) {
+void TCPReceiver::segment_received(const TCPSegment &seg, const bool accept_syn_data) {
     if (state() == State::kListen) {
         if (!seg.header().syn) {
             // Skip until receiving SYN.
@@ -12,6 +12,18 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
         is_listen_ = false;
         isn_ = seg.header().seqno;
     }
+    // Remember the timestamp to echo: only from a segment that starts at or before the ack no we
+    // advertise, so that TSecr reflects the oldest unacknowledged segment (RFC 7323 section 4.3).
+    const auto &ts = seg.header().ts;
+    if (ts.has_value() && (!ts_recent_.has_value() || static_cast<int32_t>(ts->val - ts_recent_.value()) >= 0)) {
+        const uint64_t seg_abs_seq_no = unwrap(seg.header().seqno, isn_.value(), abs_ack_no());
+        if (seg_abs_seq_no <= abs_ack_no()) {
+            ts_recent_ = ts->val;
+        }
+    }
+    if (seg.header().syn && !accept_syn_data) {
+        return;
+    }
     // Handle the payload or FIN, both could be in the same segment with SYN.
     // SYN occupies one seq no, so need to plus one if SYN was set.
     uint64_t abs_seq_no = unwrap(seg.header().seqno + seg.header().syn, isn_.value(), abs_ack_no());
@@ -22,6 +34,15 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
     }
 }
 
+bool TCPReceiver::paws_reject(const TCPSegment &seg) const {
+    const auto &ts = seg.header().ts;
+    if (seg.header().rst || !ts.has_value() || !ts_recent_.has_value()) {
+        return false;
+    }
+    // TSval comparisons are modulo 2^32, like sequence numbers.
+    return static_cast<int32_t>(ts->val - ts_recent_.value()) < 0;
+}
+
 uint64_t TCPReceiver::abs_ack_no() const {
     State s = state();
     if (s == State::kSynRecv) {
@@ -25,6 +25,9 @@ class TCPReceiver {
 
     bool is_listen_ = true;
 
+    //! TSval of the segment to echo back (RFC 7323 TS.Recent), once one has been seen.
+    std::optional<uint32_t> ts_recent_ = std::nullopt;
+
   private:
     //! Absolute ack no as the checkpoint.
     uint64_t abs_ack_no() const;
@@ -67,13 +70,27 @@ class TCPReceiver {
     //! accepted by the receiver) and (b) the sequence number of the
     //! beginning of the window (the ackno).
     size_t window_size() const;
+
+    //! \brief The most bytes that the receiver will store, and so the largest window it can offer
+    size_t capacity() const { return capacity_; }
     //!@}
 
+    //! \brief The TSval to echo in the TSecr of outgoing segments, if any
+    std::optional<uint32_t> ts_recent() const { return ts_recent_; }
+
+    //! \brief Would PAWS reject this segment as an old duplicate?
+    //! \details True for a non-RST segment whose TSval is older than TS.Recent
+    //! ([RFC 7323](https://tools.ietf.org/html/rfc7323) section 5.3). Such a segment
+    //! should be dropped (and acknowledged) instead of being passed to segment_received().
+    bool paws_reject(const TCPSegment &seg) const;
+
     //! \brief number of bytes stored but not yet reassembled
     size_t unassembled_bytes() const { return reassembler_.unassembled_bytes(); }
 
     //! \brief handle an inbound segment
-    void segment_received(const TCPSegment &seg);
+    //! \param accept_syn_data whether data on a SYN is taken; if not (TCP Fast Open without a valid
+    //! cookie), only the SYN itself is, and the peer sends the data again after the handshake
+    void segment_received(const TCPSegment &seg, const bool accept_syn_data = true);
 
     //! \name "Output" interface for the reader
     //!@{
@@ -1,44 +1,87 @@
 #include "tcp_sender.hh"
 
 #include "tcp_config.hh"
+#include "util.hh"
 
 #include <optional>
 #include <random>
+#include <utility>
+
+//! \brief A random 32-bit value, without a getrandom() call per connection
+//! \note Owners that know the 4-tuple should pass a `fixed_isn` from an IsnGenerator instead.
+static uint32_t random_u32() {
+    thread_local std::mt19937 generator{std::random_device()()};
+    return generator();
+}
 
 //! \param[in] capacity the capacity of the outgoing byte stream
 //! \param[in] retx_timeout the initial amount of time to wait before retransmitting the oldest outstanding segment
 //! \param[in] fixed_isn the Initial Sequence Number to use, if set (otherwise uses a random ISN)
 TCPSender::TCPSender(const size_t capacity, const uint16_t retx_timeout, const std::optional<WrappingInt32> fixed_isn)
-    : isn_(fixed_isn.value_or(WrappingInt32{std::random_device()()}))
-    , init_retransmission_timeout_{retx_timeout}
+    : isn_(fixed_isn.value_or(WrappingInt32{random_u32()}))
+    , ts_offset_(random_u32())
+    , timer_(retx_timeout)
     , stream_(capacity)
-    , timer_(retx_timeout) {}
+    , rtt_(retx_timeout) {}
+
+//! \param[in] cfg the configuration; with `cfg.gso` set, segments carry up to TCPConfig::GSO_MAX_PAYLOAD_SIZE bytes
+TCPSender::TCPSender(const TCPConfig &cfg) : TCPSender(cfg.send_capacity, cfg.rt_timeout, cfg.fixed_isn) {
+    max_payload_size_ = cfg.gso ? TCPConfig::GSO_MAX_PAYLOAD_SIZE : TCPConfig::MAX_PAYLOAD_SIZE;
+    ts_offset_ = cfg.fixed_ts_offset.value_or(ts_offset_);
+    persist_ = cfg.persist_timer;
+    if (cfg.rack) {
+        rack_ = std::make_unique<RackTlp>();
+    }
+}
 
 uint64_t TCPSender::bytes_in_flight() const { return bytes_in_flight_; }
 
 void TCPSender::send_segment(TCPSegment& seg) {
+    // With ECN, new data is ECN-capable, and the first after a reduction carries CWR (SYNs are neither).
+    if (ecn_ && !seg.header().syn && seg.payload().size() > 0) {
+        seg.set_ecn(TCPSegment::ECN_ECT0);
+        seg.header().cwr = ecn_->cwr_pending;
+        ecn_->cwr_pending = false;
+    }
+    // Sum the payload once (if it was not summed as it was read): the copies sent now and on every
+    // retransmission carry the sum along.
+    seg.payload_sum();
     size_t seg_length = seg.length_in_sequence_space();
     next_seq_no_ += seg_length;
     bytes_in_flight_ += seg_length;
     segments_out_.emplace(seg);
-    outstanding_segments_.emplace(std::move(seg));
+    outstanding_segments_.push(OutstandingSegment{std::move(seg), now_ms_, false});
     if (!timer_.started()) {
         timer_.restart();
     }
+    if (rack_) {
+        schedule_tlp();
+    }
+}
+
+void TCPSender::retransmit(OutstandingSegment &entry) {
+    segments_out_.push(entry.segment);
+    // A retransmission must not be ECN-capable (RFC 3168 section 6.1.5).
+    segments_out_.back().set_ecn(TCPSegment::ECN_NOT_ECT);
+    retransmitted_bytes_ += entry.segment.payload().size();
+    retransmitted_segments_++;
+    entry.sent_ms = now_ms_;
+    entry.retransmitted = true;
 }
 
 uint64_t TCPSender::free_window_size() const {
     // If the receiver has announced a window size of 0, and there is no
-    // byte in flight, we should act like the window size is 1.
-    if (window_size_ == 0 && next_seq_no_ == last_ack_no_) {
+    // byte in flight, we should act like the window size is 1 (unless the persist timer probes instead).
+    if (!persist_ && window_size_ == 0 && next_seq_no_ == last_ack_no_) {
         return 1;
     }
     // There are some bytes in flight, but the window is full, we could not
     // send anymore. Just wait for tick() to trigger the retransmission.
-    if (window_size_ <= next_seq_no_ - last_ack_no_) {
+    const uint64_t window = std::min(window_size_, congestion_window());
+    if (window <= next_seq_no_ - last_ack_no_) {
         return 0;
     }
-    return window_size_ - (next_seq_no_ - last_ack_no_);
+    return window - (next_seq_no_ - last_ack_no_);
 }
 
 void TCPSender::fill_window() {
@@ -48,9 +91,21 @@ void TCPSender::fill_window() {
         TCPSegment seg;
         seg.header().syn = true;
         seg.header().seqno = isn_;
+        if (syn_data_) {
+            InternetChecksum payload_sum;
+            seg.set_payload(stream_.read(std::min(stream_.buffer_size(), max_payload_size_), payload_sum), payload_sum);
+        }
         send_segment(seg);
         return;
     }
+    // A zero window only ever gets the persist timer's probes, which start once nothing is in flight.
+    if (persist_ && window_size_ == 0) {
+        if (has_unsent() && bytes_in_flight_ == 0 && !persist_timer_.started()) {
+            persist_timer_.reset(rtt_.rto_ms());
+            persist_timer_.restart();
+        }
+        return;
+    }
     // Try to fill the window, as long as there are new bytes to be read
     // and space available in the window.
     while (true) {
@@ -63,10 +118,12 @@ void TCPSender::fill_window() {
         if (stream_size == 0 && !need_send_fin) {
             return;
         }
-        size_t send_size = std::min(std::min(stream_size, free_window), TCPConfig::MAX_PAYLOAD_SIZE);
+        size_t send_size = std::min({stream_size, free_window, max_payload_size_});
         TCPSegment seg;
         seg.header().seqno = wrap(next_seq_no_, isn_);
-        seg.payload() = stream_.read(send_size);
+        // The payload is summed as it is copied out of the stream, so send_segment() finds its sum cached.
+        InternetChecksum payload_sum;
+        seg.set_payload(stream_.read(send_size, payload_sum), payload_sum);
         // Only when the |stream_| is ended after being read, could we sent FIN.
         // SYN_ACKED => FIN_SENT.
         if (stream_.eof() && free_window > send_size && need_send_fin) {
@@ -78,48 +135,166 @@ void TCPSender::fill_window() {
 
 //! \param ackno The remote receiver's ackno (acknowledgment number)
 //! \param window_size The remote receiver's advertised window size
-void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size) {
+//! \param ts_ecr The echoed timestamp, used as a round-trip sample when the ACK covers new data
+void TCPSender::ack_received(const WrappingInt32 ackno,
+                             const uint16_t window_size,
+                             const std::optional<uint32_t> ts_ecr) {
     size_t abs_ack_no = unwrap(ackno, isn_, last_ack_no_);
     // Ignore old / repeated ACKs and impossible ACKs (beyond next seq no).
     // Timer also does not restart without ACK of new data.
     if (abs_ack_no <= last_ack_no_ || abs_ack_no > next_seq_no_) {
         // Repeated ACKs as last time need to update the window size.
         if (abs_ack_no == last_ack_no_) {
-            window_size_ = static_cast<uint64_t>(window_size);
+            dup_acks_ += bytes_in_flight_ > 0;
+            update_window(window_size);
         }
         return;
     }
-    // RTO resets on ACK of new data.
-    timer_.reset(init_retransmission_timeout_);
     retransmission_count_ = 0;
-    // When all outstanding data has been acknowledged, keep the timer stopped.
+    // Karn's algorithm: only a segment that was never retransmitted gives an unambiguous sample.
+    std::optional<uint64_t> karn_rtt_ms{};
     while (!outstanding_segments_.empty()) {
-        const TCPSegment& seg = outstanding_segments_.front();
-        uint64_t abs_seq_no = unwrap(seg.header().seqno, isn_, last_ack_no_);
-        if (abs_seq_no + seg.length_in_sequence_space() > abs_ack_no) {
-            // If the sender still has any outstanding data, restart the retransmission timer.
-            timer_.restart();
+        const OutstandingSegment &entry = outstanding_segments_.front();
+        uint64_t abs_seq_no = unwrap(entry.segment.header().seqno, isn_, last_ack_no_);
+        if (abs_seq_no + entry.segment.length_in_sequence_space() > abs_ack_no) {
             break;
         }
         // The front segment has been fully acknowledged.
-        bytes_in_flight_ -= seg.length_in_sequence_space();
+        bytes_in_flight_ -= entry.segment.length_in_sequence_space();
+        if (rack_) {
+            rack_update(entry);
+            if (!entry.retransmitted) {
+                karn_rtt_ms = now_ms_ - entry.sent_ms;
+            }
+        }
         outstanding_segments_.pop();
     }
-    window_size_ = static_cast<uint64_t>(window_size);
+    // A SYN/ACK for our SYN but not the data on it (the server refused Fast Open): what is left
+    // becomes an ordinary data segment, sent again now instead of after an RTO.
+    if (!outstanding_segments_.empty() && outstanding_segments_.front().segment.header().syn) {
+        OutstandingSegment &entry = outstanding_segments_.front();
+        entry.segment.header().syn = false;
+        entry.segment.header().seqno = entry.segment.header().seqno + 1;
+        bytes_in_flight_--;
+        retransmit(entry);
+    }
+    // An echoed timestamp times the segment that advanced the window, even if it was a retransmission.
+    if (ts_ecr.has_value()) {
+        const uint32_t rtt_ms = ts_value() - ts_ecr.value();
+        // Anything "older" than half the clock space is a bogus echo, not a sample.
+        if (rtt_ms < (1u << 31)) {
+            rtt_.sample(rtt_ms);
+        }
+    } else if (karn_rtt_ms.has_value()) {
+        rtt_.sample(karn_rtt_ms.value());
+    }
+    // After a reduction, the congestion window grows by about one MSS per window acknowledged.
+    if (ecn_ && ecn_->cwnd != UNLIMITED_CWND) {
+        ecn_->cwnd += std::max<uint64_t>(1, TCPConfig::MAX_PAYLOAD_SIZE * (abs_ack_no - last_ack_no_) / ecn_->cwnd);
+    }
+    // RTO resets on ACK of new data.
+    timer_.reset(rtt_.rto_ms());
+    // If the sender still has any outstanding data, restart the retransmission timer.
+    // When all outstanding data has been acknowledged, keep the timer stopped.
+    if (!outstanding_segments_.empty()) {
+        timer_.restart();
+    }
+    update_window(window_size);
     last_ack_no_ = abs_ack_no;
+    // A probe the peer took, with nothing left to send, leaves the persist timer nothing to probe with.
+    if (persist_timer_.started() && outstanding_segments_.empty() && !has_unsent()) {
+        persist_timer_.reset();
+    }
+    if (rack_) {
+        // The ACK ends any probe episode, and may reveal segments sent before it as lost.
+        rack_->probe_outstanding = false;
+        rack_detect_loss();
+        schedule_tlp();
+    }
+}
+
+void TCPSender::update_window(const uint16_t window_size) {
+    window_size_ = static_cast<uint64_t>(window_size);
+    if (window_size_ > 0 && persist_timer_.started()) {
+        // The window has opened: an unacknowledged probe is ordinary data again, under the RTO.
+        persist_timer_.reset();
+        if (!outstanding_segments_.empty() && !timer_.started()) {
+            timer_.restart();
+        }
+    }
+}
+
+void TCPSender::ecn_echo_received() {
+    // Echoes keep coming until the peer sees our CWR; those for data sent before the last
+    // reduction report the same congestion.
+    if (!ecn_ || last_ack_no_ <= ecn_->recover) {
+        return;
+    }
+    ecn_->cwnd = std::max<uint64_t>(bytes_in_flight_ / 2, 2 * TCPConfig::MAX_PAYLOAD_SIZE);
+    ecn_->recover = next_seq_no_;
+    ecn_->cwr_pending = true;
+}
+
+bool TCPSender::has_unsent() const {
+    return stream_.buffer_size() > 0 || (stream_.input_ended() && state() == State::kSynAcked);
+}
+
+void TCPSender::send_window_probe() {
+    if (!outstanding_segments_.empty()) {
+        retransmit(outstanding_segments_.front());
+    } else if (!has_unsent()) {
+        persist_timer_.reset();
+        return;
+    } else {
+        // One byte (or the FIN, if not sent yet) beyond the window: the peer takes it if it has room by now.
+        TCPSegment seg;
+        seg.header().seqno = wrap(next_seq_no_, isn_);
+        seg.set_payload(stream_.read(std::min<size_t>(1, stream_.buffer_size())));
+        seg.header().fin = stream_.eof() && state() == State::kSynAcked;
+        send_segment(seg);
+        // The probe is retransmitted by the persist timer, not the RTO (or a tail loss probe).
+        timer_.reset();
+        if (rack_) {
+            rack_->tlp_timer.reset();
+        }
+    }
+    persist_timer_.reset(std::min(2 * persist_timer_.timeout_ms(), RTTEstimator::MAX_RTO_MS));
+    persist_timer_.restart();
 }
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void TCPSender::tick(const size_t ms_since_last_tick) {
+    now_ms_ += ms_since_last_tick;
     timer_.tick(ms_since_last_tick);
+    persist_timer_.tick(ms_since_last_tick);
+    if (persist_timer_.expired()) {
+        send_window_probe();
+    }
     if (!timer_.expired()) {
+        if (rack_) {
+            rack_->reorder_timer.tick(ms_since_last_tick);
+            rack_->tlp_timer.tick(ms_since_last_tick);
+            if (rack_->reorder_timer.expired()) {
+                rack_->reorder_timer.reset();
+                rack_detect_loss();
+            }
+            if (rack_->tlp_timer.expired()) {
+                rack_->tlp_timer.reset();
+                send_tlp_probe();
+            }
+        }
         return;
     }
     // If there is no outstanding segment, the timer must be stopped and cannot expire.
     assert(!outstanding_segments_.empty());
-    segments_out_.push(outstanding_segments_.front());
-    // If window size is 0, we treat it as equal to 1 but don't back off RTO.
-    if (window_size_ > 0) {
+    retransmit(outstanding_segments_.front());
+    // The RTO takes over from any pending probe until new data is acknowledged.
+    if (rack_) {
+        rack_->tlp_timer.reset();
+    }
+    // If window size is 0, we treat it as equal to 1 but don't back off RTO
+    // (with the persist timer, only data sent before the window closed is retransmitted here).
+    if (window_size_ > 0 || persist_) {
         retransmission_count_++;
         size_t rto = timer_.timeout_ms();
         timer_.reset(rto * 2);
@@ -127,8 +302,115 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
     timer_.restart();
 }
 
+void TCPSender::rack_update(const OutstandingSegment &entry) {
+    const uint64_t rtt_ms = now_ms_ - entry.sent_ms;
+    // An ACK for a retransmission that comes back faster than any RTT seen so far
+    // was really for the original transmission (RFC 8985 section 6.2, step 2).
+    if (entry.retransmitted && rack_->min_rtt_ms.has_value() && rtt_ms < rack_->min_rtt_ms.value()) {
+        return;
+    }
+    if (!entry.retransmitted) {
+        rack_->min_rtt_ms = std::min(rtt_ms, rack_->min_rtt_ms.value_or(rtt_ms));
+    }
+    if (!rack_->valid || entry.sent_ms >= rack_->xmit_ms) {
+        rack_->xmit_ms = entry.sent_ms;
+        rack_->rtt_ms = rtt_ms;
+        rack_->valid = true;
+    }
+}
+
+void TCPSender::rack_detect_loss() {
+    rack_->reorder_timer.reset();
+    if (!rack_->valid) {
+        return;
+    }
+    // Reordering window: a quarter of the minimum RTT, but never more than SRTT.
+    uint64_t reo_wnd = rack_->min_rtt_ms.value_or(0) / 4;
+    if (rtt_.has_sample()) {
+        reo_wnd = std::min<uint64_t>(reo_wnd, rtt_.srtt_ms());
+    }
+    uint64_t timeout_ms = 0;
+    for (size_t i = 0; i < outstanding_segments_.size(); i++) {
+        OutstandingSegment &entry = outstanding_segments_[i];
+        // Only a segment sent before the latest delivered one can be inferred lost. Without SACK,
+        // that happens when a retransmission is acknowledged while later holes remain.
+        if (entry.sent_ms >= rack_->xmit_ms) {
+            continue;
+        }
+        const uint64_t deadline_ms = entry.sent_ms + rack_->rtt_ms + reo_wnd;
+        if (deadline_ms <= now_ms_) {
+            retransmit(entry);
+        } else {
+            timeout_ms = std::max(timeout_ms, deadline_ms - now_ms_);
+        }
+    }
+    if (timeout_ms > 0) {
+        rack_->reorder_timer.reset(timeout_ms);
+        rack_->reorder_timer.restart();
+    }
+}
+
+void TCPSender::schedule_tlp() {
+    rack_->tlp_timer.reset();
+    if (outstanding_segments_.empty() || rack_->probe_outstanding) {
+        return;
+    }
+    size_t pto_ms = rtt_.has_sample() ? 2 * rtt_.srtt_ms() : TCPConfig::TIMEOUT_DFLT;
+    if (outstanding_segments_.size() == 1) {
+        pto_ms += TLP_DELAYED_ACK_MS;
+    }
+    // A probe that would not fire before the RTO is pointless.
+    if (pto_ms >= timer_.remaining_ms()) {
+        return;
+    }
+    rack_->tlp_timer.reset(pto_ms);
+    rack_->tlp_timer.restart();
+}
+
+void TCPSender::send_tlp_probe() {
+    if (outstanding_segments_.empty()) {
+        return;
+    }
+    rack_->probe_outstanding = true;
+    // New data makes the best probe; otherwise resend the last segment to elicit an ACK for the tail.
+    const uint64_t next_seq_no = next_seq_no_;
+    fill_window();
+    if (next_seq_no_ == next_seq_no) {
+        retransmit(outstanding_segments_.back());
+    }
+    timer_.restart();
+}
+
+std::optional<size_t> TCPSender::time_until_next_deadline() const {
+    std::optional<size_t> deadline{};
+    auto consider = [&deadline](const Timer &timer) {
+        if (timer.started()) {
+            deadline = std::min(timer.remaining_ms(), deadline.value_or(timer.remaining_ms()));
+        }
+    };
+    consider(timer_);
+    consider(persist_timer_);
+    if (rack_) {
+        consider(rack_->reorder_timer);
+        consider(rack_->tlp_timer);
+    }
+    return deadline;
+}
+
 unsigned int TCPSender::consecutive_retransmissions() const { return retransmission_count_; }
 
+TCPSender::Limit TCPSender::limit() const {
+    // As in Linux's TCP_INFO, a blocked writer counts first, then the receive window.
+    if (stream_.remaining_capacity() == 0) {
+        return Limit::kSndbuf;
+    }
+    // fill_window() sends all it can, so data still in the stream is held back by a window.
+    if (stream_.buffer_size() > 0 && (free_window_size() == 0 || window_size_ == 0)) {
+        return congestion_window() < window_size_ ? Limit::kCwnd : Limit::kRwnd;
+    }
+    return Limit::kApp;
+}
+
 void TCPSender::send_empty_segment() {
     if (segments_out_.empty()) {
         TCPSegment seg;
@@ -138,6 +420,25 @@ void TCPSender::send_empty_segment() {
     }
 }
 
+bool TCPSender::queues_oversized() const {
+    return outstanding_segments_.empty() && segments_out_.empty() &&
+           (outstanding_segments_.capacity() > IDLE_QUEUE_SLOTS || segments_out_.capacity() > IDLE_QUEUE_SLOTS);
+}
+
+void TCPSender::trim_queues() {
+    if (queues_oversized()) {
+        outstanding_segments_.shrink_to_fit();
+        segments_out_.shrink_to_fit();
+    }
+}
+
+void TCPSender::send_keepalive_probe() {
+    TCPSegment seg;
+    // An already acknowledged seqno carries nothing new, but is outside the peer's window, so it draws an ACK.
+    seg.header().seqno = wrap(next_seq_no_ - 1, isn_);
+    segments_out_.emplace(std::move(seg));
+}
+
 TCPSender::State TCPSender::state() const {
     if (stream_.error()) {
         return TCPSender::State::kError;
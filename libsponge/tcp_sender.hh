@@ -2,13 +2,17 @@
 #define SPONGE_LIBSPONGE_TCP_SENDER_HH
 
 #include "byte_stream.hh"
+#include "ring_queue.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <functional>
-#include <queue>
+#include <limits>
+#include <memory>
+#include <optional>
 
 class Timer {
   public:
@@ -35,18 +39,61 @@ class Timer {
 
     void tick(const size_t ms_since_last_tick) {
         if (started_) {
-            elapsed_ms_ += ms_since_last_tick;
+            elapsed_ms_ = static_cast<uint32_t>(
+                std::min<uint64_t>(elapsed_ms_ + ms_since_last_tick, std::numeric_limits<uint32_t>::max()));
         }
     }
 
     bool expired() const { return started_ && elapsed_ms_ >= timeout_ms_; }
 
+    size_t remaining_ms() const { return elapsed_ms_ >= timeout_ms_ ? 0 : timeout_ms_ - elapsed_ms_; }
+
   private:
-    size_t timeout_ms_;
-    size_t elapsed_ms_ = 0;  // The time elapsed since the timer reset.
+    // Milliseconds stored in 32 bits (enough for 49 days) to keep the per-connection timers small.
+    uint32_t timeout_ms_;
+    uint32_t elapsed_ms_ = 0;  // The time elapsed since the timer reset.
     bool started_ = false;
 };
 
+//! \brief Smoothed round-trip time and retransmission timeout, as in [RFC 6298](\ref rfc::rfc6298)
+class RTTEstimator {
+  public:
+    static constexpr size_t MIN_RTO_MS = 200;     //!< Lower bound on the computed RTO
+    static constexpr size_t MAX_RTO_MS = 60000;   //!< Upper bound on the computed RTO
+    static constexpr size_t CLOCK_GRANULARITY_MS = 10;  //!< G, the resolution assumed of the caller's clock
+
+    explicit RTTEstimator(const size_t initial_rto_ms) : rto_ms_(initial_rto_ms) {}
+
+    //! Fold in one round-trip measurement (longer ones count as MAX_RTO_MS, which bounds the RTO anyway)
+    void sample(size_t rtt_ms) {
+        rtt_ms = std::min(rtt_ms, MAX_RTO_MS);
+        if (!has_sample_) {
+            srtt_ms_ = rtt_ms;
+            rttvar_ms_ = rtt_ms / 2;
+            has_sample_ = true;
+        } else {
+            const size_t delta = srtt_ms_ > rtt_ms ? srtt_ms_ - rtt_ms : rtt_ms - srtt_ms_;
+            rttvar_ms_ = (3 * rttvar_ms_ + delta) / 4;
+            srtt_ms_ = (7 * srtt_ms_ + rtt_ms) / 8;
+        }
+        const size_t rto = srtt_ms_ + std::max<size_t>(CLOCK_GRANULARITY_MS, 4 * rttvar_ms_);
+        rto_ms_ = std::min(std::max(rto, MIN_RTO_MS), MAX_RTO_MS);
+    }
+
+    bool has_sample() const { return has_sample_; }
+
+    size_t srtt_ms() const { return srtt_ms_; }
+
+    //! The initial RTO until the first sample arrives
+    size_t rto_ms() const { return rto_ms_; }
+
+  private:
+    uint32_t srtt_ms_ = 0;
+    uint32_t rttvar_ms_ = 0;
+    uint32_t rto_ms_;
+    bool has_sample_ = false;
+};
+
 //! \brief The "sender" part of a TCP implementation.
 
 //! Accepts a ByteStream, divides it up into segments and sends the
@@ -55,39 +102,138 @@ class Timer {
 //! segments if the retransmission timer expires.
 class TCPSender {
   private:
+    //! \name Hot state, touched by every segment sent and every ACK (kept together at the front)
+    //!@{
+
+    //! Absolute sequence number for the next byte to be sent.
+    uint64_t next_seq_no_ = 0;
+
+    //! Absolute ack number last received.
+    uint64_t last_ack_no_ = 0;
+
+    uint64_t bytes_in_flight_ = 0;
+
+    uint64_t window_size_ = 1;
+
+    //! Milliseconds since the sender was created, advanced by tick().
+    uint64_t now_ms_ = 0;
+
+    //! Largest payload put into one segment (a super-segment when GSO is on).
+    size_t max_payload_size_ = TCPConfig::MAX_PAYLOAD_SIZE;
+
     //! Initial sequence number.
     WrappingInt32 isn_;
 
+    //! Random per-connection offset of the timestamp clock (RFC 7323 section 5.4).
+    uint32_t ts_offset_;
+
+    unsigned int retransmission_count_ = 0;
+
+    //! \name Counters for TCPConnection::stats()
+    //!@{
+    uint32_t retransmitted_segments_ = 0;
+    uint32_t dup_acks_ = 0;
+    uint64_t retransmitted_bytes_ = 0;
+    //!@}
+
+    //! May the SYN carry data? (TCP Fast Open, once the server has given us a cookie)
+    bool syn_data_ = false;
+
+    //! Is a zero window handled by persist_timer_? (TCPConfig::persist_timer)
+    bool persist_ = false;
+
+    Timer timer_;
+    //!@}
+
     //! Outbound queue of segments that the TCPSender wants sent.
-    std::queue<TCPSegment> segments_out_{};
+    RingQueue<TCPSegment> segments_out_{};
 
-    //! Segments have been sent but not yet acknowledged by the receiver.
-    std::queue<TCPSegment> outstanding_segments_{};
+    //! A segment that has been sent but not yet acknowledged, with its most recent transmit time.
+    struct OutstandingSegment {
+        TCPSegment segment{};
+        uint64_t sent_ms = 0;
+        bool retransmitted = false;
+    };
 
-    //! Initial retransmission timer for the connection.
-    unsigned int init_retransmission_timeout_;
+    //! Segments have been sent but not yet acknowledged by the receiver.
+    RingQueue<OutstandingSegment> outstanding_segments_{};
 
     //! Outgoing stream of bytes that have not yet been sent.
     ByteStream stream_;
 
-    Timer timer_;
+    //! Source of the RTO once round-trip samples are available (from echoed timestamps).
+    RTTEstimator rtt_;
 
-    size_t retransmission_count_ = 0;
+    //! Sends window probes while the peer's window is zero and nothing is in flight; its timeout
+    //! starts at the RTO and doubles with every probe, up to RTTEstimator::MAX_RTO_MS.
+    Timer persist_timer_{0};
 
-    //! Absolute sequence number for the next byte to be sent.
-    uint64_t next_seq_no_ = 0;
+    //! State of RACK-TLP (RFC 8985), which most connections never use.
+    struct RackTlp {
+        //! \name The most recently sent segment known to be delivered
+        //!@{
+        uint64_t xmit_ms = 0;                   //!< its transmit time
+        uint64_t rtt_ms = 0;                    //!< RTT measured from its (re)transmission
+        std::optional<uint64_t> min_rtt_ms{};  //!< smallest RTT seen, which sizes the reordering window
+        bool valid = false;
+        //!@}
 
-    //! Absolute ack number last received.
-    uint64_t last_ack_no_ = 0;
+        //! Has a probe been sent that no ACK has answered yet?
+        bool probe_outstanding = false;
 
-    uint64_t bytes_in_flight_ = 0;
+        //! Fires when a segment passes RACK's reordering window without being acknowledged.
+        Timer reorder_timer{0};
 
-    uint64_t window_size_ = 1;
+        //! Probe timeout (PTO) of Tail Loss Probe.
+        Timer tlp_timer{0};
+    };
+
+    //! Allocated only if RACK-TLP is on (TCPConfig::rack).
+    std::unique_ptr<RackTlp> rack_{};
+
+    //! State of ECN (RFC 3168), once the handshake has negotiated it.
+    struct Ecn {
+        //! Congestion window; only ECN limits it, so it stays unlimited until the first echoed mark.
+        uint64_t cwnd = UNLIMITED_CWND;
+
+        //! next_seq_no_ when cwnd was last reduced: echoes until that data is acknowledged are for
+        //! the same congestion.
+        uint64_t recover = 0;
+
+        //! Should the next new data segment carry CWR, to tell the peer that we reacted to its ECE?
+        bool cwr_pending = false;
+    };
+
+    //! Allocated by enable_ecn(); new data goes out ECN-capable while it exists.
+    std::unique_ptr<Ecn> ecn_{};
+
+    //! Allowance added to the PTO when one segment is in flight and its ACK may be delayed.
+    static constexpr size_t TLP_DELAYED_ACK_MS = 200;
 
   private:
 
     void send_segment(TCPSegment& seg);
 
+    //! Take a window advertisement, leaving persist mode if the window has opened.
+    void update_window(const uint16_t window_size);
+
+    //! Send (or resend) a one-byte probe of a zero window, then back off the persist timer.
+    void send_window_probe();
+
+    //! Is there data, or a FIN, that has not been sent yet?
+    bool has_unsent() const;
+
+    //! Send an outstanding segment again, restamping its transmit time.
+    void retransmit(OutstandingSegment &entry);
+
+    //! \name RACK-TLP
+    //!@{
+    void rack_update(const OutstandingSegment &entry);
+    void rack_detect_loss();
+    void schedule_tlp();
+    void send_tlp_probe();
+    //!@}
+
   public:
     enum class State {
         kError,
@@ -98,12 +244,29 @@ class TCPSender {
         kFinAcked,
     };
 
+    //! \brief What keeps the sender from sending more, for TCPConnection::stats()
+    enum class Limit : uint8_t {
+        kApp,     //!< Nothing left to send: the application has not written more
+        kRwnd,    //!< The peer's receive window holds back data
+        kCwnd,    //!< The congestion window holds back data
+        kSndbuf,  //!< The outbound stream is full, so the application cannot write more
+    };
+
   public:
+    //! cwnd_ before any congestion has been signalled: the receiver's window alone limits the sender.
+    static constexpr uint64_t UNLIMITED_CWND = std::numeric_limits<uint64_t>::max();
+
+    //! Outbound queues bigger than this give their storage back when the owner finds the connection idle.
+    static constexpr size_t IDLE_QUEUE_SLOTS = 4;
+
     //! Initialize a TCPSender
     explicit TCPSender(const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
                        const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
                        const std::optional<WrappingInt32> fixed_isn = {});
 
+    //! Initialize a TCPSender from a connection's configuration
+    explicit TCPSender(const TCPConfig &cfg);
+
     //! \name "Input" interface for the writer
     //!@{
     ByteStream &stream_in() { return stream_; }
@@ -114,11 +277,46 @@ class TCPSender {
     //!@{
 
     //! \brief A new acknowledgment was received
-    void ack_received(const WrappingInt32 ackno, const uint16_t window_size);
+    //! \param ts_ecr the TSecr of the acknowledging segment, if the connection uses timestamps
+    void ack_received(const WrappingInt32 ackno,
+                      const uint16_t window_size,
+                      const std::optional<uint32_t> ts_ecr = std::nullopt);
 
     //! \brief Generate an empty-payload segment (useful for creating empty ACK segments)
     void send_empty_segment();
 
+    //! \brief Generate a keepalive probe: an empty segment one below the next seqno, which the peer must ACK
+    void send_keepalive_probe();
+
+    //! \brief Are the queues, with nothing in them, holding more than #IDLE_QUEUE_SLOTS slots from a past burst?
+    bool queues_oversized() const;
+
+    //! \brief Give back the storage of queues_oversized() queues
+    //! \note For the owner's idle hook, not for every ACK: a trimmed queue must grow again in the next burst.
+    void trim_queues();
+
+    //! \brief Put data already written to the stream on the SYN (TCP Fast Open)
+    void send_data_on_syn(const bool enabled) { syn_data_ = enabled; }
+
+    //! \brief Take the window of the peer's SYN, so that data may follow our SYN/ACK before it is
+    //! acknowledged (a TCP Fast Open server answering data that came on the SYN)
+    void syn_window_received(const uint16_t window_size) { window_size_ = window_size; }
+
+    //! \brief The handshake negotiated ECN (RFC 3168): mark new data ECN-capable from now on
+    void enable_ecn() { ecn_ = std::make_unique<Ecn>(); }
+
+    //! \brief An ACK carried ECE: the peer saw a congestion mark on our data
+    //! \details Halves the congestion window, at most once per window of data (RFC 3168 section 6.1.2),
+    //! and puts CWR on the next new data segment; the window then grows by one MSS per round trip.
+    void ecn_echo_received();
+
+    //! \brief Send no more than `mss` bytes of payload per segment (the peer's MSS option; 0 is ignored)
+    void limit_payload_size(const size_t mss) {
+        if (mss > 0) {
+            max_payload_size_ = std::min(max_payload_size_, mss);
+        }
+    }
+
     //! \brief create and send segments to fill as much of the window as possible
     void fill_window();
 
@@ -131,7 +329,10 @@ class TCPSender {
 
     State state() const;
 
-    //! \brief Free space in the receive window.
+    //! \brief The congestion window, or UNLIMITED_CWND if no congestion has been signalled
+    uint64_t congestion_window() const { return ecn_ ? ecn_->cwnd : UNLIMITED_CWND; }
+
+    //! \brief Free space in the receive window (or the congestion window, if smaller).
     uint64_t free_window_size() const;
 
     //! \brief How many sequence numbers are occupied by segments sent but not yet acknowledged?
@@ -142,11 +343,45 @@ class TCPSender {
     //! \brief Number of consecutive retransmissions that have occurred in a row
     unsigned int consecutive_retransmissions() const;
 
+    //! \brief What limits the sender right now (between calls, this holds until the next event)
+    Limit limit() const;
+
+    //! \brief Payload bytes that the peer has acknowledged
+    uint64_t bytes_acked() const {
+        // Leave out the SYN, and the FIN once it is acknowledged.
+        return std::min<uint64_t>(last_ack_no_ > 0 ? last_ack_no_ - 1 : 0, stream_.bytes_read());
+    }
+
+    //! \brief Payload bytes sent more than once (retransmissions and probes)
+    uint64_t retransmitted_bytes() const { return retransmitted_bytes_; }
+
+    //! \brief Segments sent more than once
+    uint32_t retransmitted_segments() const { return retransmitted_segments_; }
+
+    //! \brief ACKs that acknowledged nothing new while data was in flight
+    uint32_t dup_acks() const { return dup_acks_; }
+
+    //! \brief The last window the peer advertised
+    uint64_t peer_window() const { return window_size_; }
+
+    //! \brief The current retransmission timeout, including any backoff
+    size_t rto_ms() const { return timer_.timeout_ms(); }
+
+    //! \brief Current value of the timestamp clock, for the TSval of outgoing segments
+    uint32_t ts_value() const { return ts_offset_ + static_cast<uint32_t>(now_ms_); }
+
+    //! \brief Milliseconds until tick() next has work to do (RTO, persist, or the RACK reorder and TLP timers)
+    //! \returns empty if no timer is running
+    std::optional<size_t> time_until_next_deadline() const;
+
+    //! \brief The round-trip estimator that drives the retransmission timeout
+    const RTTEstimator &rtt_estimator() const { return rtt_; }
+
     //! \brief TCPSegments that the TCPSender has enqueued for transmission.
     //! \note These must be dequeued and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
     //! (ackno and window size) before sending.
-    std::queue<TCPSegment>& segments_out() { return segments_out_; }
+    RingQueue<TCPSegment>& segments_out() { return segments_out_; }
     //!@}
 
     //! \name What is the next sequence number? (used for testing)
@@ -6,12 +6,41 @@ void Buffer::remove_prefix(const size_t n) {
     if (n > str().size()) {
         throw out_of_range("Buffer::remove_prefix");
     }
-    _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
+    _starting_offset += static_cast<uint32_t>(n);
+    _length -= static_cast<uint32_t>(n);
+    if (_storage and _length == 0) {
         _storage.reset();
     }
 }
 
+Buffer Buffer::substr(const size_t pos, const size_t n) const {
+    if (pos > size()) {
+        throw out_of_range("Buffer::substr");
+    }
+    Buffer ret;
+    ret._length = static_cast<uint32_t>(min(n, size() - pos));
+    if (ret._length > 0) {
+        ret._storage = _storage;
+        ret._starting_offset = _starting_offset + static_cast<uint32_t>(pos);
+    }
+    return ret;
+}
+
+char *Headroom::prepend(const size_t n) {
+    if (n > _front) {
+        throw out_of_range("Headroom::prepend");
+    }
+    _front -= n;
+    return _storage.data() + _front;
+}
+
+Buffer Headroom::release() && {
+    const size_t front = _front;
+    Buffer ret{move(_storage)};
+    ret.remove_prefix(front);
+    return ret;
+}
+
 void BufferList::append(const BufferList &other) {
     for (const auto &buf : other._buffers) {
         _buffers.push_back(buf);
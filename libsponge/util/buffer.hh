@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
 #include <algorithm>
+#include <cstdint>
 #include <deque>
 #include <memory>
 #include <numeric>
@@ -12,16 +13,20 @@
 #include <vector>
 
 //! \brief A reference-counted read-only string that can discard bytes from the front
+//! \note Offsets are 32 bits wide, which keeps every queued TCPSegment 8 bytes smaller; a Buffer
+//! holds one datagram or payload, far below the 4 GiB this allows.
 class Buffer {
   private:
     std::shared_ptr<std::string> _storage{};
-    size_t _starting_offset{};
+    uint32_t _starting_offset{};
+    uint32_t _length{};  //!< Bytes visible from `_starting_offset` on (a substr() may end before the storage does)
 
   public:
     Buffer() = default;
 
     //! \brief Construct by taking ownership of a string
-    Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
+    Buffer(std::string &&str) noexcept
+        : _storage(std::make_shared<std::string>(std::move(str))), _length(static_cast<uint32_t>(_storage->size())) {}
 
     //! \name Expose contents as a std::string_view
     //!@{
@@ -29,7 +34,7 @@ class Buffer {
         if (not _storage) {
             return {};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return {_storage->data() + _starting_offset, _length};
     }
 
     operator std::string_view() const { return str(); }
@@ -47,6 +52,10 @@ class Buffer {
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief The `n` bytes (or as many as there are) from position `pos` on, sharing this Buffer's storage
+    //! \note Like remove_prefix(), doesn't copy; the storage lives on until every Buffer that shares it is gone.
+    Buffer substr(const size_t pos, const size_t n = std::string::npos) const;
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -94,6 +103,30 @@ class BufferList {
     std::string concatenate() const;
 };
 
+//! \brief Room for a packet's headers, written back to front into a single allocation
+//! \details Each layer prepend()s its header in front of the ones already written (TCP, then IPv4,
+//! then Ethernet), and release() hands them all over as one Buffer without copying, to go in front
+//! of the payload in a BufferList.
+class Headroom {
+  private:
+    std::string _storage;
+    size_t _front;  //!< Where the headers written so far begin
+
+  public:
+    //! \brief Make room for `capacity` bytes of headers
+    explicit Headroom(const size_t capacity) : _storage(capacity, '\0'), _front(capacity) {}
+
+    //! \brief Claim the `n` bytes in front of the headers written so far
+    //! \returns where to write them; throws if there is not enough room left
+    char *prepend(const size_t n);
+
+    //! \brief The headers written so far
+    std::string_view str() const { return std::string_view(_storage).substr(_front); }
+
+    //! \brief Hand the headers over, sharing the allocation
+    Buffer release() &&;
+};
+
 //! \brief A non-owning temporary view (similar to std::string_view) of a discontiguous string
 class BufferViewList {
     std::deque<std::string_view> _views{};
@@ -0,0 +1,244 @@
+#include "util.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPONGE_CHECKSUM_X86 1
+#endif
+
+using namespace std;
+
+//! A kernel's summing loop: the ones'-complement sum of the 16-bit words in `[data, data + len)`,
+//! read in host byte order, with `len` even. The result is not folded to 16 bits. A copying loop also
+//! stores the words it reads to `dest`.
+using SumFunction = uint64_t (*)(const char *data, const size_t len, char *dest);
+
+//! Ones'-complement addition of 64-bit words: the carry out of the top wraps around to the bottom.
+static inline uint64_t add_with_carry(const uint64_t sum, const uint64_t x) {
+    const uint64_t result = sum + x;
+    return result + (result < x);
+}
+
+static inline uint16_t fold(uint64_t sum) {
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return static_cast<uint16_t>(sum);
+}
+
+template <bool COPY>
+static uint64_t sum_words(const char *data, const size_t len, char *dest) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if constexpr (COPY) {
+            memcpy(dest + i, &word, sizeof(word));
+        }
+        sum = add_with_carry(sum, word);
+    }
+    for (; i < len; i += 2) {
+        uint16_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if constexpr (COPY) {
+            memcpy(dest + i, &word, sizeof(word));
+        }
+        sum = add_with_carry(sum, word);
+    }
+    return sum;
+}
+
+#ifdef SPONGE_CHECKSUM_X86
+
+//! The SIMD kernels widen each 16-bit word into a 32-bit lane, which takes two words per block.
+//! After this many blocks a lane could overflow, so it is added into the 64-bit total first.
+static constexpr size_t MAX_BLOCKS_PER_LANE_SUM = 32768;
+
+template <bool COPY>
+__attribute__((target("sse2"))) static uint64_t sum_sse2(const char *data, const size_t len, char *dest) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+    size_t i = 0;
+    while (len - i >= sizeof(__m128i)) {
+        const size_t blocks = min((len - i) / sizeof(__m128i), MAX_BLOCKS_PER_LANE_SUM);
+        __m128i lanes = zero;
+        for (size_t b = 0; b < blocks; b++, i += sizeof(__m128i)) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            if constexpr (COPY) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), v);
+            }
+            lanes = _mm_add_epi32(lanes, _mm_unpacklo_epi16(v, zero));
+            lanes = _mm_add_epi32(lanes, _mm_unpackhi_epi16(v, zero));
+        }
+        array<uint32_t, 4> lane_sums{};
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_sums.data()), lanes);
+        for (const uint32_t lane_sum : lane_sums) {
+            sum += lane_sum;
+        }
+    }
+    return add_with_carry(sum, sum_words<COPY>(data + i, len - i, COPY ? dest + i : nullptr));
+}
+
+template <bool COPY>
+__attribute__((target("avx2"))) static uint64_t sum_avx2(const char *data, const size_t len, char *dest) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    size_t i = 0;
+    while (len - i >= sizeof(__m256i)) {
+        const size_t blocks = min((len - i) / sizeof(__m256i), MAX_BLOCKS_PER_LANE_SUM);
+        __m256i lanes = zero;
+        for (size_t b = 0; b < blocks; b++, i += sizeof(__m256i)) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            if constexpr (COPY) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i), v);
+            }
+            lanes = _mm256_add_epi32(lanes, _mm256_unpacklo_epi16(v, zero));
+            lanes = _mm256_add_epi32(lanes, _mm256_unpackhi_epi16(v, zero));
+        }
+        array<uint32_t, 8> lane_sums{};
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_sums.data()), lanes);
+        for (const uint32_t lane_sum : lane_sums) {
+            sum += lane_sum;
+        }
+    }
+    return add_with_carry(sum, sum_words<COPY>(data + i, len - i, COPY ? dest + i : nullptr));
+}
+
+#endif  // SPONGE_CHECKSUM_X86
+
+template <bool COPY>
+static SumFunction sum_function(const InternetChecksum::Kernel kernel) {
+    switch (kernel) {
+#ifdef SPONGE_CHECKSUM_X86
+        case InternetChecksum::Kernel::SSE2:
+            return sum_sse2<COPY>;
+        case InternetChecksum::Kernel::AVX2:
+            return sum_avx2<COPY>;
+#endif
+        default:
+            return sum_words<COPY>;
+    }
+}
+
+bool InternetChecksum::kernel_supported(const Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Bytewise:
+        case Kernel::Words:
+            return true;
+#ifdef SPONGE_CHECKSUM_X86
+        case Kernel::SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case Kernel::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+InternetChecksum::Kernel InternetChecksum::best_kernel() {
+    static const Kernel best = kernel_supported(Kernel::AVX2)   ? Kernel::AVX2
+                               : kernel_supported(Kernel::SSE2) ? Kernel::SSE2
+                                                                : Kernel::Words;
+    return best;
+}
+
+//! \note This class returns the checksum in host byte order.
+//!       See https://commandcenter.blogspot.com/2012/04/byte-order-fallacy.html for rationale
+//! \details This class can be used to either check or compute an Internet checksum
+//! (e.g., for an IP datagram header or a TCP segment).
+//!
+//! The Internet checksum is defined such that evaluating inet_cksum() on a TCP segment (IP datagram, etc)
+//! containing a correct checksum header will return zero. In other words, if you read a correct TCP segment
+//! off the wire and pass it untouched to inet_cksum(), the return value will be 0.
+//!
+//! Meanwhile, to compute the checksum for an outgoing TCP segment (IP datagram, etc.), you must first set
+//! the checksum header to zero, then call inet_cksum(), and finally set the checksum header to the return
+//! value.
+//!
+//! For more information, see the [Wikipedia page](https://en.wikipedia.org/wiki/IPv4_header_checksum)
+//! on the Internet checksum, and consult the [IP](\ref rfc::rfc791) and [TCP](\ref rfc::rfc793) RFCs.
+InternetChecksum::InternetChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
+
+//! Below this length (a bare TCP header, say) the vector loops do not pay for their setup.
+static constexpr size_t MIN_VECTOR_LENGTH = 32;
+
+static InternetChecksum::Kernel kernel_for(const size_t len) {
+    return len < MIN_VECTOR_LENGTH ? InternetChecksum::Kernel::Words : InternetChecksum::best_kernel();
+}
+
+void InternetChecksum::add(std::string_view data) { _add(data, kernel_for(data.size()), nullptr); }
+
+void InternetChecksum::add(std::string_view data, const Kernel kernel) { _add(data, kernel, nullptr); }
+
+void InternetChecksum::copy_and_add(char *dest, std::string_view data) {
+    _add(data, kernel_for(data.size()), dest);
+}
+
+void InternetChecksum::copy_and_add(char *dest, std::string_view data, const Kernel kernel) {
+    _add(data, kernel, dest);
+}
+
+void InternetChecksum::_add(std::string_view data, const Kernel kernel, char *dest) {
+    if (kernel == Kernel::Bytewise) {
+        if (dest != nullptr) {
+            memcpy(dest, data.data(), data.size());
+        }
+        for (size_t i = 0; i < data.size(); i++) {
+            uint16_t val = uint8_t(data[i]);
+            if (not _parity) {
+                val <<= 8;
+            }
+            _sum += val;
+            _parity = !_parity;
+        }
+        return;
+    }
+
+    // a byte left over from the previous call was the high half of a word; this one's first byte is its low half
+    if (_parity and not data.empty()) {
+        _sum += uint8_t(data.front());
+        _parity = false;
+        if (dest != nullptr) {
+            *dest++ = data.front();
+        }
+        data.remove_prefix(1);
+    }
+
+    // The sum of the words read in host byte order, folded, is the sum in network byte order with its
+    // two bytes swapped: end-around carry makes the ones'-complement sum independent of byte order
+    // (RFC 1071 section 2).
+    const size_t even = data.size() & ~size_t{1};
+    const SumFunction sum_loop = dest != nullptr ? sum_function<true>(kernel) : sum_function<false>(kernel);
+    const uint16_t sum = fold(sum_loop(data.data(), even, dest));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    _sum += __builtin_bswap16(sum);
+#else
+    _sum += sum;
+#endif
+
+    if (data.size() % 2 == 1) {
+        _sum += uint16_t(uint8_t(data.back()) << 8);
+        _parity = true;
+        if (dest != nullptr) {
+            dest[even] = data.back();
+        }
+    }
+    _sum = fold(_sum);
+}
+
+uint16_t InternetChecksum::value() const {
+    uint32_t ret = _sum;
+
+    while (ret > 0xffff) {
+        ret = (ret >> 16) + (ret & 0xffff);
+    }
+
+    return ~ret;
+}
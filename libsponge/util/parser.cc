@@ -1,5 +1,7 @@
 #include "parser.hh"
 
+#include <cstring>
+
 using namespace std;
 
 //! \param[in] r is the ParseResult to show
@@ -50,6 +52,16 @@ void NetParser::remove_prefix(const size_t n) {
     _buffer.remove_prefix(n);
 }
 
+optional<NetFields> NetParser::fixed(const size_t n) {
+    _check_size(n);
+    if (error()) {
+        return {};
+    }
+    const NetFields fields{_buffer};
+    _buffer.remove_prefix(n);
+    return fields;
+}
+
 template <typename T>
 void NetUnparser::_unparse_int(string &s, T val) {
     constexpr size_t len = sizeof(T);
@@ -70,3 +82,28 @@ void NetUnparser::u32(string &s, const uint32_t val) { return _unparse_int<uint3
 void NetUnparser::u16(string &s, const uint16_t val) { return _unparse_int<uint16_t>(s, val); }
 
 void NetUnparser::u8(string &s, const uint8_t val) { return _unparse_int<uint8_t>(s, val); }
+
+char *NetUnparser::u32(char *dest, const uint32_t val) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const uint32_t net = __builtin_bswap32(val);
+#else
+    const uint32_t net = val;
+#endif
+    memcpy(dest, &net, sizeof(net));
+    return dest + sizeof(net);
+}
+
+char *NetUnparser::u16(char *dest, const uint16_t val) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const uint16_t net = __builtin_bswap16(val);
+#else
+    const uint16_t net = val;
+#endif
+    memcpy(dest, &net, sizeof(net));
+    return dest + sizeof(net);
+}
+
+char *NetUnparser::u8(char *dest, const uint8_t val) {
+    *dest = static_cast<char>(val);
+    return dest + 1;
+}
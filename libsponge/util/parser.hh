@@ -5,7 +5,10 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 
 //! The result of parsing or unparsing an IP datagram, TCP segment, Ethernet frame, or ARP message
@@ -22,6 +25,40 @@ enum class ParseResult {
 //! Output a string representation of a ParseResult
 std::string as_string(const ParseResult r);
 
+//! \brief Fields at fixed offsets in a block of bytes whose length has already been checked
+//! \details Each load is a single unaligned read plus a byte swap, with no bounds check and no change
+//! to a Buffer; see NetParser::fixed().
+class NetFields {
+  private:
+    Buffer _buffer;           //!< Keeps the bytes alive after the parser has moved past them
+    std::string_view _bytes;  //!< The bytes themselves, at the front of `_buffer`
+
+    //! Load the integer in network byte order at `offset`
+    template <typename T>
+    T _load(const size_t offset) const {
+        T val;
+        memcpy(&val, _bytes.data() + offset, sizeof(T));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if constexpr (sizeof(T) == 4) {
+            val = __builtin_bswap32(val);
+        } else if constexpr (sizeof(T) == 2) {
+            val = __builtin_bswap16(val);
+        }
+#endif
+        return val;
+    }
+
+  public:
+    explicit NetFields(const Buffer &buffer) : _buffer(buffer), _bytes(_buffer.str()) {}
+
+    //! \name Loads, in network byte order, of the integer at a byte offset (which must be in range)
+    //!@{
+    uint32_t u32(const size_t offset) const { return _load<uint32_t>(offset); }
+    uint16_t u16(const size_t offset) const { return _load<uint16_t>(offset); }
+    uint8_t u8(const size_t offset) const { return _load<uint8_t>(offset); }
+    //!@}
+};
+
 class NetParser {
   private:
     Buffer _buffer;
@@ -60,6 +97,10 @@ class NetParser {
 
     //! Remove n bytes from the buffer
     void remove_prefix(const size_t n);
+
+    //! \brief Take the next `n` bytes, checking their length once, for a header with a fixed layout
+    //! \returns the bytes' fields, or nothing (with the error set) if fewer than `n` bytes are left
+    std::optional<NetFields> fixed(const size_t n);
 };
 
 struct NetUnparser {
@@ -74,6 +115,14 @@ struct NetUnparser {
 
     //! Write an 8-bit integer into the data stream in network byte order
     static void u8(std::string &s, const uint8_t val);
+
+    //! \name Store an integer in network byte order at `dest`, which has room for it
+    //! \returns the byte after it, where the next field goes
+    //!@{
+    static char *u32(char *dest, const uint32_t val);
+    static char *u16(char *dest, const uint16_t val);
+    static char *u8(char *dest, const uint8_t val);
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_PARSER_HH
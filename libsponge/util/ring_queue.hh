@@ -0,0 +1,107 @@
+#ifndef SPONGE_LIBSPONGE_RING_QUEUE_HH
+#define SPONGE_LIBSPONGE_RING_QUEUE_HH
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//! \brief A FIFO queue over a ring of reusable slots
+//! \details Offers the subset of the std::queue interface used in this codebase, plus indexed
+//! access from the front. Slots are constructed up front and reused: pushing move-assigns into
+//! the next slot and popping resets it (so that, e.g., a popped segment's payload is released)
+//! without freeing it. Storage only grows, by doubling, when a push finds every slot in use,
+//! so a queue that has reached its working size no longer allocates. By default nothing is
+//! allocated until the first push, so an idle queue costs only its own few words.
+template <typename T>
+class RingQueue {
+  private:
+    std::vector<T> _slots;
+    size_t _head = 0;  //!< Index of the front element in `_slots`
+    size_t _size = 0;
+
+    size_t _index(const size_t i) const { return (_head + i) & (_slots.size() - 1); }
+
+    void _grow() {
+        std::vector<T> slots(_slots.empty() ? 1 : _slots.size() * 2);
+        for (size_t i = 0; i < _size; i++) {
+            slots[i] = std::move(_slots[_index(i)]);
+        }
+        _slots = std::move(slots);
+        _head = 0;
+    }
+
+    static size_t _round_up(const size_t n) {
+        size_t capacity = 1;
+        while (capacity < n) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+  public:
+    //! \param[in] capacity number of slots to preconstruct (rounded up to a power of two), if any
+    explicit RingQueue(const size_t capacity = 0) : _slots(capacity == 0 ? 0 : _round_up(capacity)) {}
+
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+    size_t capacity() const { return _slots.size(); }
+
+    //! \name Access, from the front (oldest) to the back (newest)
+    //!@{
+    T &front() { return _slots[_head]; }
+    const T &front() const { return _slots[_head]; }
+    T &back() { return _slots[_index(_size - 1)]; }
+    const T &back() const { return _slots[_index(_size - 1)]; }
+    T &operator[](const size_t i) { return _slots[_index(i)]; }
+    const T &operator[](const size_t i) const { return _slots[_index(i)]; }
+    //!@}
+
+    //! \brief Append an element, reusing the next free slot
+    void push(T &&value) {
+        if (_size == _slots.size()) {
+            _grow();
+        }
+        _slots[_index(_size)] = std::move(value);
+        _size++;
+    }
+
+    void push(const T &value) { push(T(value)); }
+
+    //! \brief Construct an element from `args` and append it
+    template <typename... Args>
+    T &emplace(Args &&... args) {
+        push(T(std::forward<Args>(args)...));
+        return back();
+    }
+
+    //! \brief Remove the front element, leaving its slot reset for reuse
+    void pop() {
+        _slots[_head] = T{};
+        _head = _index(1);
+        _size--;
+    }
+
+    //! \brief Give back the storage of slots not in use, keeping a power-of-two capacity
+    //! \details For owners that know the queue will stay small for a while (e.g. an idle connection
+    //! after a burst); an empty queue frees everything, like a default-constructed one.
+    void shrink_to_fit() {
+        const size_t capacity = _size == 0 ? 0 : _round_up(_size);
+        if (capacity == _slots.size()) {
+            return;
+        }
+        std::vector<T> slots(capacity);
+        for (size_t i = 0; i < _size; i++) {
+            slots[i] = std::move(_slots[_index(i)]);
+        }
+        _slots = std::move(slots);
+        _head = 0;
+    }
+
+    void clear() {
+        while (not empty()) {
+            pop();
+        }
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_RING_QUEUE_HH
@@ -0,0 +1,69 @@
+#include "siphash.hh"
+
+#include <random>
+
+using namespace std;
+
+static inline uint64_t rotl(const uint64_t x, const int b) { return (x << b) | (x >> (64 - b)); }
+
+static inline void sip_round(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3) {
+    v0 += v1;
+    v1 = rotl(v1, 13);
+    v1 ^= v0;
+    v0 = rotl(v0, 32);
+    v2 += v3;
+    v3 = rotl(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = rotl(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = rotl(v1, 17);
+    v1 ^= v2;
+    v2 = rotl(v2, 32);
+}
+
+SipHash::Key SipHash::random_key() {
+    random_device rd;
+    Key key{};
+    for (auto &word : key) {
+        word = (uint64_t{rd()} << 32) | rd();
+    }
+    return key;
+}
+
+//! \details Follows the reference implementation; input words are read little-endian.
+uint64_t SipHash::operator()(const uint8_t *data, const size_t len) const {
+    uint64_t v0 = 0x736f6d6570736575 ^ _key[0];
+    uint64_t v1 = 0x646f72616e646f6d ^ _key[1];
+    uint64_t v2 = 0x6c7967656e657261 ^ _key[0];
+    uint64_t v3 = 0x7465646279746573 ^ _key[1];
+
+    const size_t whole = len - len % 8;
+    for (size_t i = 0; i < whole; i += 8) {
+        uint64_t m = 0;
+        for (size_t j = 0; j < 8; j++) {
+            m |= uint64_t{data[i + j]} << (8 * j);
+        }
+        v3 ^= m;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    // the last word holds the remaining bytes and the length
+    uint64_t m = uint64_t{len & 0xff} << 56;
+    for (size_t j = 0; j < len % 8; j++) {
+        m |= uint64_t{data[whole + j]} << (8 * j);
+    }
+    v3 ^= m;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    v0 ^= m;
+
+    v2 ^= 0xff;
+    for (size_t i = 0; i < 4; i++) {
+        sip_round(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
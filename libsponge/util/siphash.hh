@@ -0,0 +1,28 @@
+#ifndef SPONGE_LIBSPONGE_SIPHASH_HH
+#define SPONGE_LIBSPONGE_SIPHASH_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+//! \brief SipHash-2-4, a keyed hash (pseudorandom function) for short inputs
+//! \details Used where the output must be unpredictable to anyone who does not know the key,
+//! such as initial sequence numbers and SYN cookies.
+class SipHash {
+  public:
+    using Key = std::array<uint64_t, 2>;  //!< 128-bit secret key
+
+  private:
+    Key _key;
+
+  public:
+    explicit SipHash(const Key &key) : _key(key) {}
+
+    //! \brief A key drawn from std::random_device
+    static Key random_key();
+
+    //! \brief Hash `len` bytes at `data`
+    uint64_t operator()(const uint8_t *data, const size_t len) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_SIPHASH_HH
@@ -0,0 +1,174 @@
+#include "timing_wheel.hh"
+
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+TimingWheel::TimingWheel(const uint64_t granularity_ms) : _granularity_ms(granularity_ms) {
+    if (granularity_ms == 0) {
+        throw runtime_error("TimingWheel granularity must be positive");
+    }
+    _heads.fill(NIL);
+}
+
+//! Put node `n` at the head of the slot that matches its expiry, relative to the current tick.
+void TimingWheel::_link(const uint32_t n) {
+    Node &node = _nodes[n];
+    static constexpr uint64_t RANGE = uint64_t{1} << (SLOT_BITS * LEVELS);
+    // a deadline past the top level's range is parked in the top level and re-placed when it cascades
+    const uint64_t expiry = min(node.expiry_tick, _tick + RANGE - 1);
+    const uint64_t delta = expiry - _tick;
+
+    size_t level = 0;
+    while (level + 1 < LEVELS and delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    const size_t index = (expiry >> (SLOT_BITS * level)) & (SLOTS - 1);
+    const uint32_t slot = level * SLOTS + index;
+
+    node.slot = slot;
+    node.prev = NIL;
+    node.next = _heads[slot];
+    if (node.next != NIL) {
+        _nodes[node.next].prev = n;
+    }
+    _heads[slot] = n;
+    _occupied[level] |= uint64_t{1} << index;
+}
+
+void TimingWheel::_unlink(const uint32_t n) {
+    Node &node = _nodes[n];
+    if (node.prev != NIL) {
+        _nodes[node.prev].next = node.next;
+    } else {
+        _heads[node.slot] = node.next;
+        if (node.next == NIL) {
+            _occupied[node.slot / SLOTS] &= ~(uint64_t{1} << (node.slot % SLOTS));
+        }
+    }
+    if (node.next != NIL) {
+        _nodes[node.next].prev = node.prev;
+    }
+    node.prev = node.next = NIL;
+}
+
+//! Move every timer in the current slot of `level` down to where it now belongs.
+void TimingWheel::_cascade(const size_t level) {
+    const size_t index = (_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+    uint32_t n = _heads[level * SLOTS + index];
+    _heads[level * SLOTS + index] = NIL;
+    _occupied[level] &= ~(uint64_t{1} << index);
+    while (n != NIL) {
+        const uint32_t next = _nodes[n].next;
+        _link(n);
+        n = next;
+    }
+}
+
+void TimingWheel::_step() {
+    _tick++;
+    // a higher level first: its timers may land in the lower level's slot that cascades next
+    for (size_t level = LEVELS - 1; level > 0; level--) {
+        if ((_tick & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) == 0) {
+            _cascade(level);
+        }
+    }
+
+    const uint32_t slot = _tick & (SLOTS - 1);
+    while (_heads[slot] != NIL) {
+        const uint32_t n = _heads[slot];
+        _unlink(n);
+        Node &node = _nodes[n];
+        if (node.expiry_tick > _tick) {
+            // parked beyond the wheel's range; not due yet
+            _link(n);
+            continue;
+        }
+        Callback callback = move(node.callback);
+        node.callback = nullptr;
+        node.slot = NIL;
+        node.generation++;
+        _free.push_back(n);
+        _size--;
+        callback();
+    }
+}
+
+//! The first tick after the current one at which _step() has something to do: fire or re-place the
+//! timers in a level-0 slot, or cascade an occupied slot of a higher level. Only valid while timers are pending.
+uint64_t TimingWheel::_next_event_tick() const {
+    uint64_t next = UINT64_MAX;
+    for (size_t level = 0; level < LEVELS; level++) {
+        if (_occupied[level] == 0) {
+            continue;
+        }
+        // level `level` reaches slot `j` at the first tick past now that is a multiple of SLOTS^level
+        // and whose index there is `j`: `base` is that multiple's count, `distance` how many more to go
+        const uint64_t base = (_tick >> (SLOT_BITS * level)) + 1;
+        const size_t shift = base & (SLOTS - 1);
+        const uint64_t rotated = shift == 0 ? _occupied[level]
+                                            : (_occupied[level] >> shift) | (_occupied[level] << (SLOTS - shift));
+        const uint64_t distance = static_cast<uint64_t>(__builtin_ctzll(rotated));
+        next = min(next, (base + distance) << (SLOT_BITS * level));
+    }
+    return next;
+}
+
+//! \param[in] delay_ms time from now until the timer fires (at least one tick)
+//! \param[in] callback what to call when it fires
+TimingWheel::TimerId TimingWheel::schedule(const uint64_t delay_ms, Callback callback) {
+    uint32_t n;
+    if (not _free.empty()) {
+        n = _free.back();
+        _free.pop_back();
+    } else {
+        n = static_cast<uint32_t>(_nodes.size());
+        _nodes.emplace_back();
+    }
+
+    // round up, and count the part of a tick already waiting in _pending_ms
+    const uint64_t ticks = max<uint64_t>(1, (delay_ms + _pending_ms + _granularity_ms - 1) / _granularity_ms);
+    Node &node = _nodes[n];
+    node.callback = move(callback);
+    node.expiry_tick = _tick + ticks;
+    _link(n);
+    _size++;
+
+    return (uint64_t{node.generation} << 32) | n;
+}
+
+bool TimingWheel::cancel(const TimerId id) {
+    const uint32_t n = static_cast<uint32_t>(id);
+    const uint32_t generation = static_cast<uint32_t>(id >> 32);
+    if (n >= _nodes.size() or _nodes[n].generation != generation or _nodes[n].slot == NIL) {
+        return false;
+    }
+
+    _unlink(n);
+    Node &node = _nodes[n];
+    node.callback = nullptr;
+    node.slot = NIL;
+    node.generation++;
+    _free.push_back(n);
+    _size--;
+    return true;
+}
+
+void TimingWheel::advance(const uint64_t elapsed_ms) {
+    const uint64_t total_ms = _pending_ms + elapsed_ms;
+    uint64_t ticks = total_ms / _granularity_ms;
+    // callbacks run at their tick's time, so timers they schedule must not count the remainder
+    _pending_ms = 0;
+    while (ticks > 0 and _size > 0) {
+        // the ticks before the next occupied slot comes around would do nothing, so skip them
+        const uint64_t skip = min(ticks, _next_event_tick() - _tick) - 1;
+        _tick += skip;
+        ticks -= skip;
+        _step();
+        ticks--;
+    }
+    // nothing left to fire or cascade, so jump straight to the new time
+    _tick += ticks;
+    _pending_ms = total_ms % _granularity_ms;
+}
@@ -0,0 +1,82 @@
+#ifndef SPONGE_LIBSPONGE_TIMING_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMING_WHEEL_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+//! \brief A hierarchical timing wheel that keeps deadlines for many timers
+//! \details Level 0 has #SLOTS slots of `granularity_ms` each, and every slot of level `k + 1`
+//! spans one full revolution of level `k`. A timer sits in one slot of the lowest level whose
+//! range covers its deadline and moves down a level when its slot comes around ("cascading"),
+//! so scheduling, cancelling and firing a timer are all O(1). Idle timers are never touched
+//! between those events, and advance() jumps over the ticks where nothing fires or cascades,
+//! found from a bitmap of occupied slots per level. Deadlines beyond the top level's range are
+//! parked there and re-placed as they come closer.
+class TimingWheel {
+  public:
+    using Callback = std::function<void(void)>;  //!< Called when a timer expires
+    using TimerId = uint64_t;                    //!< Handle returned by schedule(), accepted by cancel()
+
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;  //!< Slots per level
+    static constexpr size_t LEVELS = 4;                      //!< Levels, for a range of SLOTS^LEVELS ticks
+
+  private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    //! A scheduled timer, linked into the list of its slot.
+    struct Node {
+        Callback callback{};
+        uint64_t expiry_tick = 0;
+        uint32_t generation = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t slot = NIL;  //!< level * SLOTS + index, or NIL when the node is free
+    };
+
+    uint64_t _granularity_ms;
+    uint64_t _tick = 0;        //!< Ticks elapsed since construction
+    uint64_t _pending_ms = 0;  //!< Time passed to advance() that does not yet add up to a tick
+    size_t _size = 0;
+
+    std::vector<Node> _nodes{};
+    std::vector<uint32_t> _free{};
+    std::array<uint32_t, LEVELS * SLOTS> _heads{};
+    std::array<uint64_t, LEVELS> _occupied{};  //!< Per level, a bit for each slot whose list is not empty
+
+    static_assert(SLOTS == 64, "the occupied-slot bitmaps hold one level's slots in a uint64_t");
+
+    void _link(const uint32_t n);
+    void _unlink(const uint32_t n);
+    void _cascade(const size_t level);
+    void _step();
+    uint64_t _next_event_tick() const;
+
+  public:
+    //! \param[in] granularity_ms the length of one tick; deadlines are rounded up to a whole tick
+    explicit TimingWheel(const uint64_t granularity_ms = 1);
+
+    //! \brief Arrange for `callback` to be called once `delay_ms` have passed
+    //! \returns a handle for cancel(); handles are never reused while the timer is pending
+    TimerId schedule(const uint64_t delay_ms, Callback callback);
+
+    //! \brief Stop a pending timer
+    //! \returns `false` if the timer had already fired or been cancelled
+    bool cancel(const TimerId id);
+
+    //! \brief Let time pass, calling the callbacks of all timers that expire, earliest tick first
+    //! \note Callbacks may schedule and cancel timers, including their own.
+    void advance(const uint64_t elapsed_ms);
+
+    //! \brief Number of pending timers
+    size_t size() const { return _size; }
+
+    //! \brief Milliseconds since construction, as seen by the wheel (a multiple of the granularity)
+    uint64_t now_ms() const { return _tick * _granularity_ms; }
+};
+
+#endif  // SPONGE_LIBSPONGE_TIMING_WHEEL_HH
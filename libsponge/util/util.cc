@@ -69,44 +69,6 @@ mt19937 get_random_generator() {
     return mt19937(seed);
 }
 
-//! \note This class returns the checksum in host byte order.
-//!       See https://commandcenter.blogspot.com/2012/04/byte-order-fallacy.html for rationale
-//! \details This class can be used to either check or compute an Internet checksum
-//! (e.g., for an IP datagram header or a TCP segment).
-//!
-//! The Internet checksum is defined such that evaluating inet_cksum() on a TCP segment (IP datagram, etc)
-//! containing a correct checksum header will return zero. In other words, if you read a correct TCP segment
-//! off the wire and pass it untouched to inet_cksum(), the return value will be 0.
-//!
-//! Meanwhile, to compute the checksum for an outgoing TCP segment (IP datagram, etc.), you must first set
-//! the checksum header to zero, then call inet_cksum(), and finally set the checksum header to the return
-//! value.
-//!
-//! For more information, see the [Wikipedia page](https://en.wikipedia.org/wiki/IPv4_header_checksum)
-//! on the Internet checksum, and consult the [IP](\ref rfc::rfc791) and [TCP](\ref rfc::rfc793) RFCs.
-InternetChecksum::InternetChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
-
-void InternetChecksum::add(std::string_view data) {
-    for (size_t i = 0; i < data.size(); i++) {
-        uint16_t val = uint8_t(data[i]);
-        if (not _parity) {
-            val <<= 8;
-        }
-        _sum += val;
-        _parity = !_parity;
-    }
-}
-
-uint16_t InternetChecksum::value() const {
-    uint32_t ret = _sum;
-
-    while (ret > 0xffff) {
-        ret = (ret >> 16) + (ret & 0xffff);
-    }
-
-    return ~ret;
-}
-
 //! \param[in] data is a pointer to the bytes to show
 //! \param[in] len is the number of bytes to show
 //! \param[in] indent is the number of spaces to indent
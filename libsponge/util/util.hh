@@ -52,15 +52,49 @@ std::mt19937 get_random_generator();
 uint64_t timestamp_ms();
 
 //! The internet checksum algorithm
+//! \details add() sums eight bytes at a time, with SSE2 or AVX2 when the CPU has them (see
+//! best_kernel()). Data may be added in pieces of any length and alignment, and copied while it is
+//! summed (copy_and_add()).
 class InternetChecksum {
+  public:
+    //! Implementations of the summing loop (see checksum.cc)
+    enum class Kernel {
+        Bytewise,  //!< One byte per iteration: the reference implementation
+        Words,     //!< 64-bit words with end-around carry
+        SSE2,      //!< 16 bytes per iteration (x86 only)
+        AVX2,      //!< 32 bytes per iteration (x86 only)
+    };
+
   private:
     uint32_t _sum;
     bool _parity{};
 
+    //! Add `data` with `kernel`, also copying it to `dest` unless that is null
+    void _add(std::string_view data, const Kernel kernel, char *dest);
+
   public:
     InternetChecksum(const uint32_t initial_sum = 0);
+
+    //! Add `data` with the best_kernel() (or, for a few bytes, Kernel::Words)
     void add(std::string_view data);
+
+    //! Add `data` with the given kernel, which must be supported (for tests and benchmarks)
+    void add(std::string_view data, const Kernel kernel);
+
+    //! Add `data` and copy it to `dest` (which has room for `data.size()` bytes) in the same pass, so
+    //! that bytes being copied anyway are only read once
+    void copy_and_add(char *dest, std::string_view data);
+
+    //! copy_and_add() with the given kernel, which must be supported (for tests and benchmarks)
+    void copy_and_add(char *dest, std::string_view data, const Kernel kernel);
+
     uint16_t value() const;
+
+    //! Can this CPU run `kernel`?
+    static bool kernel_supported(const Kernel kernel);
+
+    //! The fastest supported kernel, chosen when first asked for
+    static Kernel best_kernel();
 };
 
 //! Hexdump the contents of a packet (or any other sequence of bytes)
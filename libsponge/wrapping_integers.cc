@@ -1,6 +1,7 @@
 #include "wrapping_integers.hh"
 
 #include <cassert>
+#include <limits>
 
 //! Transform an "absolute" 64-bit sequence number (zero-indexed) into a WrappingInt32
 //! \param n The input absolute 64-bit sequence number
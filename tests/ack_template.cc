@@ -0,0 +1,75 @@
+#include "ack_template.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        AckTemplate ack_template;
+
+        // a template ACK is the datagram serialized the ordinary way (but for which of the checksum's two
+        // forms of zero it picks), for any values of the fields that change, across connections
+        for (unsigned int round = 0; round < 10000; round++) {
+            const FourTuple tuple{0x0a000001, 4242, round < 5000 ? 0x0a000002 : 0xc0a80101, 80};
+            TCPSegment seg;
+            seg.header().ack = true;
+            seg.header().ece = rd() % 2;
+            seg.header().seqno = WrappingInt32{static_cast<uint32_t>(rd())};
+            seg.header().ackno = WrappingInt32{static_cast<uint32_t>(rd())};
+            seg.header().win = static_cast<uint16_t>(rd());
+            if (rd() % 2) {
+                seg.header().ts = TCPHeader::Timestamps{static_cast<uint32_t>(rd()), static_cast<uint32_t>(rd())};
+            }
+            test_should_be(AckTemplate::fits(seg), true);
+
+            const string from_template{ack_template.serialize(tuple, seg)};
+            string expected = TCPOverIPv4Adapter::serialize_tcp_in_ip(tuple, seg).concatenate();
+            test_should_be(from_template.size(), expected.size());
+
+            InternetDatagram dgram;
+            test_should_be(dgram.parse(string(from_template)) == ParseResult::NoError, true);
+            TCPSegment parsed;
+            test_should_be(parsed.parse(dgram.payload(), dgram.header().pseudo_cksum()) == ParseResult::NoError,
+                           true);
+            TCPHeader expected_header = seg.header();
+            expected_header.doff = parsed.header().doff;
+            expected_header.cksum = parsed.header().cksum;
+            test_should_be(parsed.header() == expected_header, true);
+
+            const size_t cksum_offset = IPv4Header::LENGTH + 16;
+            expected.replace(cksum_offset, 2, from_template.substr(cksum_offset, 2));
+            test_should_be(from_template == expected, true);
+        }
+
+        // anything else goes the ordinary way
+        {
+            TCPSegment with_payload;
+            with_payload.set_payload(string("x"));
+            test_should_be(AckTemplate::fits(with_payload), false);
+
+            TCPSegment with_sack;
+            with_sack.header().sack.push_back({WrappingInt32{1}, WrappingInt32{2}});
+            test_should_be(AckTemplate::fits(with_sack), false);
+
+            TCPSegment ect;
+            ect.set_ecn(TCPSegment::ECN_ECT0);
+            test_should_be(AckTemplate::fits(ect), false);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
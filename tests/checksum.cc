@@ -0,0 +1,205 @@
+#include "byte_stream.hh"
+#include "parser.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+using Kernel = InternetChecksum::Kernel;
+
+static const vector<Kernel> KERNELS = {Kernel::Words, Kernel::SSE2, Kernel::AVX2};
+
+//! Checksum `data`, added in pieces of the given lengths (the last piece takes the rest)
+static uint16_t checksum(const Kernel kernel,
+                         const uint32_t initial_sum,
+                         string_view data,
+                         const vector<size_t> &pieces = {}) {
+    InternetChecksum check{initial_sum};
+    for (const size_t piece : pieces) {
+        check.add(data.substr(0, piece), kernel);
+        data.remove_prefix(min(piece, data.size()));
+    }
+    check.add(data, kernel);
+    return check.value();
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        test_err_if(not InternetChecksum::kernel_supported(InternetChecksum::best_kernel()),
+                    "best kernel not supported");
+
+        // a known value: the IPv4 header example on Wikipedia's "IPv4 header checksum" page, checksum zeroed
+        {
+            const string header = {'\x45', '\x00', '\x00', '\x73', '\x00', '\x00', '\x40', '\x00', '\x40', '\x11',
+                                   '\x00', '\x00', '\xc0', '\xa8', '\x00', '\x01', '\xc0', '\xa8', '\x00', '\xc7'};
+            for (const Kernel kernel : KERNELS) {
+                if (InternetChecksum::kernel_supported(kernel)) {
+                    test_err_if(checksum(kernel, 0, header) != 0xb861, "wrong checksum of a known header");
+                }
+            }
+        }
+
+        // every kernel agrees with the bytewise reference, for lengths around the vector widths, at every
+        // alignment, split into pieces of any length, and with any initial sum
+        {
+            const string buffer = [&] {
+                string s(100000, '\0');
+                for (auto &ch : s) {
+                    ch = static_cast<char>(rd());
+                }
+                return s;
+            }();
+            const string ones(70000, '\xff');
+
+            for (unsigned int round = 0; round < 20000; round++) {
+                const size_t length = round < 200 ? round : rd() % (round % 100 == 0 ? 70000 : 2000);
+                const size_t offset = rd() % 64;
+                const string_view data = string_view(round % 7 == 0 ? ones : buffer).substr(offset, length);
+                // like a pseudo-header sum (the bytewise reference loses carries out of 32 bits)
+                const uint32_t initial_sum = round % 3 == 0 ? 0 : rd() % 0x40000;
+                vector<size_t> pieces;
+                for (unsigned int i = rd() % 4; i > 0; i--) {
+                    pieces.push_back(rd() % (length + 1));
+                }
+
+                const uint16_t expected = checksum(Kernel::Bytewise, initial_sum, data, pieces);
+                for (const Kernel kernel : KERNELS) {
+                    if (not InternetChecksum::kernel_supported(kernel)) {
+                        continue;
+                    }
+                    test_err_if(checksum(kernel, initial_sum, data, pieces) != expected,
+                                "kernel " + to_string(static_cast<int>(kernel)) + " disagrees on " +
+                                    to_string(length) + " bytes at offset " + to_string(offset));
+                    test_err_if(checksum(kernel, initial_sum, data) != expected,
+                                "checksum depends on how the data is split");
+                }
+            }
+        }
+
+        // copying while summing gives the same sum as summing, and an exact copy, whatever the pieces
+        {
+            string data(3000, '\0');
+            for (auto &ch : data) {
+                ch = static_cast<char>(rd());
+            }
+            for (unsigned int round = 0; round < 2000; round++) {
+                const size_t offset = rd() % 64;
+                const string_view view = string_view(data).substr(offset, rd() % (data.size() - offset));
+                const size_t split = rd() % (view.size() + 1);
+                const uint16_t expected = checksum(Kernel::Bytewise, 0, view);
+                for (const Kernel kernel : {Kernel::Bytewise, Kernel::Words, Kernel::SSE2, Kernel::AVX2}) {
+                    if (not InternetChecksum::kernel_supported(kernel)) {
+                        continue;
+                    }
+                    string copy(view.size() + 1, '!');
+                    InternetChecksum check;
+                    check.copy_and_add(copy.data(), view.substr(0, split), kernel);
+                    check.copy_and_add(copy.data() + split, view.substr(split), kernel);
+                    test_err_if(check.value() != expected, "copying changes the checksum");
+                    test_err_if(string_view(copy).substr(0, view.size()) != view, "bad copy");
+                    test_err_if(copy.back() != '!', "copy runs past its end");
+                }
+            }
+        }
+
+        // a ByteStream read sums the bytes it reads, across the wrap of its ring buffer
+        {
+            ByteStream stream{1000};
+            string written;
+            for (unsigned int round = 0; round < 200; round++) {
+                string data(rd() % (stream.remaining_capacity() + 1), '\0');
+                for (auto &ch : data) {
+                    ch = static_cast<char>(rd());
+                }
+                stream.write(data);
+                InternetChecksum check;
+                const string read = stream.read(rd() % (stream.buffer_size() + 1), check);
+                InternetChecksum reference;
+                reference.add(read);
+                test_err_if(check.value() != reference.value(), "ByteStream read sums the wrong bytes");
+                written += data;
+                test_err_if(written.substr(0, read.size()) != read, "ByteStream read with a sum reads the wrong bytes");
+                written.erase(0, read.size());
+            }
+
+            TCPSegment seg;
+            stream.write(string(777, 'z'));
+            InternetChecksum check;
+            seg.set_payload(stream.read(777, check), check);
+            const uint16_t sum = seg.payload_sum();
+            test_err_if(sum != TCPSegment(seg).payload_sum(), "payload sum not kept");
+            seg.set_payload(string(seg.payload().str()));
+            test_err_if(seg.payload_sum() != sum, "payload sum from the read differs from a fresh one");
+        }
+
+        // a segment with a correct checksum sums to zero
+        {
+            string segment(1501, '\0');
+            for (auto &ch : segment) {
+                ch = static_cast<char>(rd());
+            }
+            segment[10] = segment[11] = 0;
+            const uint16_t cksum = checksum(Kernel::Bytewise, 0, segment);
+            segment[10] = static_cast<char>(cksum >> 8);
+            segment[11] = static_cast<char>(cksum & 0xff);
+            for (const Kernel kernel : KERNELS) {
+                if (InternetChecksum::kernel_supported(kernel)) {
+                    test_err_if(checksum(kernel, 0, segment, {3, 500, 501}) != 0, "correct checksum not verified");
+                }
+            }
+        }
+
+        // a TCP segment keeps its payload's sum across header changes, and drops it when the payload changes
+        {
+            const uint32_t pseudo_sum = 0x1234;
+            auto parses = [&](const TCPSegment &seg) {
+                TCPSegment parsed;
+                return parsed.parse(seg.serialize(pseudo_sum).concatenate(), pseudo_sum) == ParseResult::NoError;
+            };
+            TCPSegment seg;
+            seg.header().ack = true;
+            seg.set_payload(string(1001, 'x'));
+            const uint16_t sum = seg.payload_sum();
+            test_err_if(not parses(seg), "segment with a cached payload sum does not parse");
+
+            TCPSegment copy = seg;
+            copy.header().ackno = WrappingInt32{123456};
+            copy.header().win = 777;
+            copy.header().ts = TCPHeader::Timestamps{1, 2};
+            test_err_if(copy.payload_sum() != sum, "payload sum not carried by a copy");
+            test_err_if(not parses(copy), "re-stamped segment does not parse");
+
+            copy.set_payload(string(1001, 'y'));
+            test_err_if(copy.payload_sum() == sum, "payload sum not recomputed for a new payload");
+            test_err_if(not parses(copy), "segment with a new payload does not parse");
+
+            const uint16_t copy_sum = copy.payload_sum();
+            test_err_if(copy.payload().size() != 1001 or copy.payload_sum() != copy_sum, "reading drops the sum");
+            copy.mutable_payload().remove_prefix(1);
+            test_err_if(copy.payload_sum() == copy_sum, "payload sum not recomputed after an in-place change");
+            test_err_if(not parses(copy), "segment changed in place does not parse");
+
+            TCPSegment zeros;
+            zeros.set_payload(string(100, '\0'));
+            test_err_if(zeros.payload_sum() == 0, "a zero sum is not cached");
+            test_err_if(not parses(zeros), "segment with an all-zero payload does not parse");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#include "connection_table.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+static FourTuple tuple_for(const uint32_t n) {
+    // many flows from one client address, as a busy server would see them
+    return {0x0a000001, 80, 0x0a000002, static_cast<uint16_t>(n)};
+}
+
+int main() {
+    try {
+        // matches std::unordered_map through a random mix of inserts and erases
+        {
+            ConnectionTable<unsigned> table{4};
+            unordered_map<uint32_t, unsigned> reference;
+            mt19937 rd{12345};
+            for (unsigned i = 0; i < 200000; i++) {
+                const uint32_t n = rd() % 3000;
+                if (rd() % 3 == 0) {
+                    test_err_if(table.erase(tuple_for(n)) != (reference.erase(n) == 1), "erase() mismatch");
+                } else {
+                    const auto inserted = table.insert(tuple_for(n), unsigned{i});
+                    const auto expected = reference.emplace(n, i);
+                    test_err_if(inserted.second != expected.second, "insert() reported the wrong outcome");
+                    test_err_if(*inserted.first != expected.first->second, "insert() returned the wrong value");
+                }
+                test_err_if(table.size() != reference.size(), "size() mismatch");
+            }
+
+            for (uint32_t n = 0; n < 3000; n++) {
+                const unsigned *value = table.find(tuple_for(n));
+                const auto it = reference.find(n);
+                test_err_if((value == nullptr) != (it == reference.end()), "find() disagrees on membership");
+                test_err_if(value != nullptr and *value != it->second, "find() returned the wrong value");
+            }
+
+            size_t visited = 0;
+            table.for_each([&](const FourTuple &key, const unsigned value) {
+                visited++;
+                test_err_if(reference.at(key.remote_port) != value, "for_each() returned the wrong value");
+            });
+            test_err_if(visited != reference.size(), "for_each() visited the wrong number of entries");
+            test_err_if(4 * table.size() > 3 * table.capacity(), "table is over its load factor");
+        }
+
+        // every field of the tuple takes part in the key
+        {
+            ConnectionTable<int> table;
+            const FourTuple base{1, 2, 3, 4};
+            table.insert(base, 0);
+            table.insert({9, 2, 3, 4}, 1);
+            table.insert({1, 9, 3, 4}, 2);
+            table.insert({1, 2, 9, 4}, 3);
+            table.insert({1, 2, 3, 9}, 4);
+            test_err_if(table.size() != 5, "distinct tuples collided");
+            test_err_if(*table.find(base) != 0, "lost the original entry");
+            test_err_if(table.insert(base, 7).second, "inserted a duplicate key");
+            test_err_if(*table.find(base) != 0, "a duplicate insert overwrote the value");
+            test_err_if(table.find({1, 2, 3, 5}) != nullptr, "found a missing key");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#include "fastopen.hh"
+#include "multiplexer_harness.hh"
+#include "tcp_listener.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static TCPHeader::FastOpenCookie make_cookie(const string &bytes) {
+    TCPHeader::FastOpenCookie cookie;
+    cookie.length = static_cast<uint8_t>(bytes.size());
+    for (size_t i = 0; i < bytes.size(); i++) {
+        cookie.bytes[i] = static_cast<uint8_t>(bytes[i]);
+    }
+    return cookie;
+}
+
+int main() {
+    try {
+        // the option survives serialization, as a request and as a cookie, next to the other options
+        {
+            for (const string bytes : {"", "abcd", "0123456789abcdef"}) {
+                TCPSegment seg;
+                seg.header().syn = true;
+                seg.header().mss = 1460;
+                seg.header().ts = TCPHeader::Timestamps{1, 2};
+                seg.header().fastopen = make_cookie(bytes);
+                seg.set_payload(Buffer(string("data")));
+                TCPSegment parsed;
+                test_err_if(parsed.parse(Buffer(seg.serialize().concatenate())) != ParseResult::NoError,
+                            "segment with a Fast Open option did not parse");
+                const TCPHeader &header = parsed.header();
+                test_err_if(header.fastopen != seg.header().fastopen, "Fast Open option did not round-trip");
+                test_err_if(header.mss != 1460 or not header.ts.has_value(), "other options lost");
+                test_err_if(parsed.payload().str() != "data", "payload lost after the options");
+            }
+        }
+
+        // cookies are a function of the client's address; the cache forgets the oldest server
+        {
+            const FastOpenCookies cookies{{1, 2}};
+            test_err_if(cookies.cookie(CLIENT_IP) != cookies.cookie(CLIENT_IP), "cookie is not deterministic");
+            test_err_if(cookies.cookie(CLIENT_IP) == cookies.cookie(CLIENT_IP + 1), "two clients share a cookie");
+            test_err_if(cookies.cookie(CLIENT_IP).length != FastOpenCookies::LENGTH, "wrong cookie length");
+
+            FastOpenCache cache{2};
+            cache.insert(1, make_cookie("aaaa"));
+            cache.insert(2, make_cookie("bbbb"));
+            cache.insert(1, make_cookie("cccc"));
+            test_err_if(cache.find(1) != make_cookie("cccc"), "cache did not replace a cookie");
+            cache.insert(3, make_cookie("dddd"));
+            test_err_if(cache.size() != 2 or cache.find(1).has_value(), "cache did not evict the oldest server");
+            test_err_if(cache.find(3) != make_cookie("dddd"), "cache lost the newest cookie");
+        }
+
+        TCPConfig cfg;
+        cfg.fastopen = true;
+
+        // the first connection asks for a cookie; the second sends its request on the SYN
+        {
+            TCPMultiplexer client{cfg};
+            TCPListener server{cfg};
+
+            client.connect(client_tuple(0), "first");
+            const TCPSegment syn = to_listener(client, server);
+            test_err_if(not syn.header().fastopen.has_value() or not syn.header().fastopen->empty(),
+                        "first SYN did not request a cookie");
+            test_err_if(syn.payload().size() != 0, "data sent on a SYN without a cookie");
+            const TCPSegment synack = to_client(server, client);
+            test_err_if(not synack.header().fastopen.has_value() or synack.header().fastopen->empty(),
+                        "SYN/ACK did not issue a cookie");
+            test_err_if(client.fastopen_cache().find(SERVER_IP) != synack.header().fastopen,
+                        "client did not cache the cookie");
+            to_listener(client, server);  // the final ACK, then the data
+            const auto first = server.accept();
+            test_err_if(not first.has_value() or first->remote_port != 10000, "first connection not accepted");
+
+            client.connect(client_tuple(1), "request");
+            const TCPSegment data_syn = to_listener(client, server);
+            test_err_if(data_syn.payload().str() != "request", "request not sent on the SYN");
+            test_err_if(data_syn.header().fastopen != synack.header().fastopen, "SYN did not present the cookie");
+
+            // the server has the request before the handshake completes
+            const auto tuple = server.accept();
+            test_err_if(not tuple.has_value() or tuple->remote_port != 10001, "SYN with data not accepted at once");
+            TCPConnection *conn = server.connections().find(*tuple);
+            test_err_if(conn->inbound_stream().read(7) != "request", "SYN data not delivered");
+            server.connections().write(*tuple, "response");
+
+            const TCPSegment reply = to_client(server, client);
+            test_err_if(not reply.header().ack or reply.header().ackno != data_syn.header().seqno + 8,
+                        "SYN data not acknowledged");
+            TCPConnection *client_conn = client.find(client_tuple(1));
+            test_err_if(client_conn->inbound_stream().read(8) != "response", "response not received in one RTT");
+            test_err_if(client_conn->bytes_in_flight() != 0, "client still has the SYN data in flight");
+        }
+
+        // a wrong cookie: the SYN data is dropped and sent again right after the handshake
+        {
+            TCPMultiplexer client{cfg};
+            TCPListener server{cfg};
+            client.fastopen_cache().insert(SERVER_IP, make_cookie("forged!!"));
+
+            client.connect(client_tuple(2), "request");
+            const TCPSegment syn = to_listener(client, server);
+            test_err_if(syn.payload().str() != "request", "request not sent on the SYN");
+            test_err_if(server.accept().has_value(), "SYN with a wrong cookie accepted early");
+
+            const TCPSegment synack = to_client(server, client);
+            test_err_if(synack.header().ackno != syn.header().seqno + 1, "SYN/ACK acknowledged refused data");
+            test_err_if(not synack.header().fastopen.has_value() or synack.header().fastopen->empty(),
+                        "SYN/ACK did not issue the right cookie");
+            test_err_if(client.fastopen_cache().find(SERVER_IP) != synack.header().fastopen,
+                        "client kept the wrong cookie");
+
+            const TCPSegment resent = to_listener(client, server);
+            test_err_if(resent.header().syn or resent.payload().str() != "request", "data not sent again");
+            const auto tuple = server.accept();
+            test_err_if(not tuple.has_value(), "connection not accepted after the handshake");
+            test_err_if(server.connections().find(*tuple)->inbound_stream().read(7) != "request",
+                        "resent data not delivered");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
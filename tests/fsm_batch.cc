@@ -0,0 +1,81 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        const WrappingInt32 tx_isn{1000};
+        const WrappingInt32 rx_isn{5000};
+
+        // test #1: a burst of data segments gets a single ACK covering all of them
+        {
+            TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_1.execute(SendSegmentBatch{}
+                               .with_segment(SendSegment{}.with_ack(true).with_seqno(rx_isn + 1).with_ackno(tx_isn + 1)
+                                                 .with_win(1000).with_data("abc"))
+                               .with_segment(SendSegment{}.with_ack(true).with_seqno(rx_isn + 4).with_ackno(tx_isn + 1)
+                                                 .with_win(1000).with_data("def"))
+                               .with_segment(SendSegment{}.with_ack(true).with_seqno(rx_isn + 7).with_ackno(tx_isn + 1)
+                                                 .with_win(1000).with_data("ghi")));
+            test_1.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 10).with_payload_size(0),
+                           "test 1 failed: burst not answered by exactly one ACK");
+            test_1.execute(ExpectData{}.with_data("abcdefghi"));
+        }
+
+        // test #2: data the application wrote earlier carries the ACK for the burst
+        {
+            TCPTestHarness test_2 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_2.execute(SendSegmentBatch{}
+                               .with_segment(SendSegment{}.with_ack(true).with_seqno(rx_isn + 1).with_ackno(tx_isn + 1)
+                                                 .with_win(0).with_data("abc"))
+                               .with_segment(SendSegment{}.with_ack(true).with_seqno(rx_isn + 4).with_ackno(tx_isn + 1)
+                                                 .with_win(1000).with_data("def")));
+            test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 7).with_payload_size(0));
+            test_2.execute(Write{"xyz"});
+            test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 7).with_data("xyz"),
+                           "test 2 failed: window update from the batch was lost");
+        }
+
+        // test #3: a RST in the batch ends processing
+        {
+            TCPTestHarness test_3 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_3.execute(SendSegmentBatch{}
+                               .with_segment(SendSegment{}.with_rst(true).with_seqno(rx_isn + 1))
+                               .with_segment(SendSegment{}.with_ack(true).with_seqno(rx_isn + 1).with_ackno(tx_isn + 1)
+                                                 .with_win(1000).with_data("abc")));
+            test_3.execute(ExpectState{State::RESET});
+            test_3.execute(ExpectNoSegment{}, "test 3 failed: reply after RST");
+        }
+
+        // test #4: segments ignored in LISTEN do not provoke a SYN, a SYN in the batch does get SYN/ACK
+        {
+            TCPTestHarness test_4{cfg};
+            test_4.execute(Listen{});
+            test_4.execute(SendSegmentBatch{}.with_segment(SendSegment{}.with_ack(true).with_seqno(rx_isn)));
+            test_4.execute(ExpectNoSegment{}, "test 4 failed: reply to a non-SYN in LISTEN");
+            test_4.execute(ExpectState{State::LISTEN});
+            test_4.execute(SendSegmentBatch{}
+                               .with_segment(SendSegment{}.with_ack(true).with_seqno(rx_isn))
+                               .with_segment(SendSegment{}.with_syn(true).with_seqno(rx_isn)));
+            test_4.execute(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(rx_isn + 1));
+            test_4.execute(ExpectState{State::SYN_RCVD});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
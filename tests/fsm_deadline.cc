@@ -0,0 +1,66 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+
+        // test #1: the SYN's retransmission timer, then nothing once established and idle
+        {
+            TCPTestHarness test_1{cfg};
+            test_1.execute(ExpectNextDeadline{nullopt}, "test 1 failed: deadline before connecting");
+
+            test_1.execute(Connect{});
+            TCPSegment syn = test_1.expect_seg(ExpectOneSegment{}.with_syn(true), "test 1 failed: no SYN");
+            test_1.execute(ExpectNextDeadline{cfg.rt_timeout});
+            test_1.execute(Tick(300));
+            test_1.execute(ExpectNextDeadline{cfg.rt_timeout - 300u});
+
+            const WrappingInt32 isn{7};
+            test_1.send_syn(isn, syn.header().seqno + 1);
+            test_1.execute(ExpectOneSegment{}.with_ack(true).with_ackno(isn + 1), "test 1 failed: no ACK");
+            test_1.execute(ExpectState{State::ESTABLISHED});
+            test_1.execute(ExpectNextDeadline{nullopt}, "test 1 failed: deadline while idle");
+
+            // data in flight arms the RTO again
+            test_1.execute(Write{"hello"});
+            test_1.execute(ExpectOneSegment{}.with_data("hello"));
+            test_1.execute(ExpectNextDeadline{cfg.rt_timeout});
+        }
+
+        // test #2: TIME_WAIT's linger timer
+        {
+            TCPTestHarness test_2 = TCPTestHarness::in_time_wait(cfg);
+            test_2.execute(ExpectNextDeadline{10u * cfg.rt_timeout});
+            test_2.execute(Tick(cfg.rt_timeout));
+            test_2.execute(ExpectNextDeadline{9u * cfg.rt_timeout});
+            test_2.execute(Tick(9 * cfg.rt_timeout));
+            test_2.execute(ExpectState{State::CLOSED});
+            test_2.execute(ExpectNextDeadline{nullopt}, "test 2 failed: deadline after closing");
+        }
+
+        // test #3: the earlier of the retransmission and linger timers (CLOSING)
+        {
+            TCPTestHarness test_3 = TCPTestHarness::in_closing(cfg);
+            test_3.execute(ExpectNextDeadline{cfg.rt_timeout});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
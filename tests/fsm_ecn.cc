@@ -0,0 +1,197 @@
+#include "lossy_fd_adapter.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <string>
+
+using namespace std;
+
+//! Stands in for a real FdAdapter under a LossyFdAdapter: what is written can be read back, in order.
+class LoopbackAdapter {
+  private:
+    FdAdapterConfig _cfg;
+    queue<TCPSegment> _segments{};
+
+  public:
+    explicit LoopbackAdapter(const FdAdapterConfig &cfg) : _cfg(cfg) {}
+
+    optional<TCPSegment> read() {
+        if (_segments.empty()) {
+            return {};
+        }
+        TCPSegment seg = move(_segments.front());
+        _segments.pop();
+        return seg;
+    }
+
+    void write(TCPSegment &seg) { _segments.push(seg); }
+
+    bool empty() const { return _segments.empty(); }
+
+    const FdAdapterConfig &config() const { return _cfg; }
+};
+
+//! An established ECN connection: our SYN offered ECN, and the SYN/ACK accepted it.
+static TCPTestHarness ecn_established(const TCPConfig &cfg, const WrappingInt32 tx_isn, const WrappingInt32 rx_isn) {
+    TCPTestHarness h = TCPTestHarness::in_syn_sent(cfg, tx_isn);
+    h.execute(
+        SendSegment{}.with_syn(true).with_ack(true).with_ece(true).with_seqno(rx_isn).with_ackno(tx_isn + 1).with_win(
+            10000));
+    h.execute(ExpectOneSegment{}.with_ack(true).with_ece(false).with_cwr(false).with_ackno(rx_isn + 1));
+    return h;
+}
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.ecn = true;
+        const WrappingInt32 tx_isn{1000};
+        const WrappingInt32 rx_isn{5000};
+
+        // test #1: the SYN offers ECN with ECE and CWR; the SYN/ACK accepts it with ECE alone
+        {
+            TCPConfig client_cfg{cfg};
+            client_cfg.fixed_isn = tx_isn;
+            TCPTestHarness test_1{client_cfg};
+            test_1.execute(Connect{});
+            test_1.execute(ExpectOneSegment{}.with_syn(true).with_ece(true).with_cwr(true),
+                           "test 1 failed: SYN does not offer ECN");
+
+            TCPTestHarness server = TCPTestHarness::in_listen(cfg);
+            server.execute(SendSegment{}.with_syn(true).with_ece(true).with_cwr(true).with_seqno(rx_isn));
+            server.execute(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ece(true).with_cwr(false),
+                           "test 1 failed: SYN/ACK does not accept ECN");
+
+            TCPTestHarness plain = TCPTestHarness::in_listen(TCPConfig{});
+            plain.execute(SendSegment{}.with_syn(true).with_ece(true).with_cwr(true).with_seqno(rx_isn));
+            plain.execute(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ece(false),
+                          "test 1 failed: ECN accepted without being configured");
+        }
+
+        // test #2: a CE mark is echoed on every ACK until the peer sends CWR
+        {
+            TCPTestHarness test_2 = ecn_established(cfg, tx_isn, rx_isn);
+            test_2.execute(SendSegment{}.with_ack(true).with_seqno(rx_isn + 1).with_ackno(tx_isn + 1).with_data("abc"));
+            test_2.execute(ExpectOneSegment{}.with_ece(false).with_ackno(rx_isn + 4), "test 2 failed: echo without CE");
+            test_2.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(rx_isn + 4)
+                               .with_ackno(tx_isn + 1)
+                               .with_data("def")
+                               .with_ecn(TCPSegment::ECN_CE));
+            test_2.execute(ExpectOneSegment{}.with_ece(true).with_ackno(rx_isn + 7), "test 2 failed: CE not echoed");
+            test_2.execute(SendSegment{}.with_ack(true).with_seqno(rx_isn + 7).with_ackno(tx_isn + 1).with_data("ghi"));
+            test_2.execute(ExpectOneSegment{}.with_ece(true).with_ackno(rx_isn + 10),
+                           "test 2 failed: echo stopped before CWR");
+            test_2.execute(
+                SendSegment{}.with_ack(true).with_cwr(true).with_seqno(rx_isn + 10).with_ackno(tx_isn + 1).with_data(
+                    "jkl"));
+            test_2.execute(ExpectOneSegment{}.with_ece(false).with_ackno(rx_isn + 13),
+                           "test 2 failed: echo continued after CWR");
+        }
+
+        // test #3: an echoed mark halves the window in flight, once, and the next new data carries CWR
+        {
+            TCPTestHarness test_3 = ecn_established(cfg, tx_isn, rx_isn);
+            test_3.execute(Write{string(4000, 'x')});
+            for (unsigned int i = 0; i < 4; i++) {
+                test_3.execute(ExpectSegment{}.with_payload_size(1000).with_cwr(false));
+            }
+            test_3.execute(
+                SendSegment{}.with_ack(true).with_ece(true).with_seqno(rx_isn + 1).with_ackno(tx_isn + 1001).with_win(
+                    10000));
+            test_3.execute(ExpectBytesInFlight{3000});
+            test_3.execute(Write{string(1000, 'y')});
+            test_3.execute(ExpectNoSegment{}, "test 3 failed: window not reduced by the echo");
+
+            test_3.execute(
+                SendSegment{}.with_ack(true).with_ece(true).with_seqno(rx_isn + 1).with_ackno(tx_isn + 4001).with_win(
+                    10000));
+            test_3.execute(ExpectOneSegment{}.with_payload_size(1000).with_cwr(true),
+                           "test 3 failed: no CWR on the first new data");
+            test_3.execute(Write{string(1000, 'z')});
+            test_3.execute(ExpectOneSegment{}.with_payload_size(1000).with_cwr(false),
+                           "test 3 failed: second reduction for the same congestion");
+        }
+
+        // test #4: end to end through a CE-marking LossyFdAdapter: data is ECN-capable, marks come back as ECE,
+        // the sender answers with CWR and a smaller window, and nothing is lost
+        {
+            FdAdapterConfig marking{};
+            marking.ce_rate_up = numeric_limits<uint16_t>::max();
+            LossyFdAdapter<LoopbackAdapter> client_to_server{LoopbackAdapter{marking}};
+            LoopbackAdapter server_to_client{FdAdapterConfig{}};
+
+            TCPConfig client_cfg{cfg};
+            client_cfg.fixed_isn = tx_isn;
+            TCPConfig server_cfg{cfg};
+            server_cfg.fixed_isn = rx_isn;
+            TCPConnection client{client_cfg};
+            TCPConnection server{server_cfg};
+
+            size_t marked = 0;
+            size_t echoes = 0;
+            size_t reductions = 0;
+            auto exchange = [&] {
+                while (not client.segments_out().empty() or not server.segments_out().empty()) {
+                    for (; not client.segments_out().empty(); client.segments_out().pop()) {
+                        TCPSegment &seg = client.segments_out().front();
+                        test_err_if(seg.payload().size() > 0 and seg.ecn() != TCPSegment::ECN_ECT0,
+                                    "test 4 failed: data not sent ECN-capable");
+                        reductions += seg.header().cwr;
+                        client_to_server.write(seg);
+                    }
+                    for (auto seg = client_to_server.read(); seg.has_value(); seg = client_to_server.read()) {
+                        marked += seg->ecn() == TCPSegment::ECN_CE;
+                        server.segment_received(seg.value());
+                    }
+                    for (; not server.segments_out().empty(); server.segments_out().pop()) {
+                        TCPSegment &seg = server.segments_out().front();
+                        test_err_if(seg.payload().size() == 0 and seg.ecn() != TCPSegment::ECN_NOT_ECT,
+                                    "test 4 failed: pure ACK sent ECN-capable");
+                        echoes += seg.header().ece and not seg.header().syn;
+                        server_to_client.write(seg);
+                    }
+                    for (auto seg = server_to_client.read(); seg.has_value(); seg = server_to_client.read()) {
+                        client.segment_received(seg.value());
+                    }
+                }
+            };
+
+            client.connect();
+            exchange();
+            test_err_if(not client.handshake_complete(), "test 4 failed: no handshake");
+
+            const string data(30000, 'd');
+            size_t written = client.write(data.substr(0, 10000));
+            test_err_if(client.bytes_in_flight() != 10000, "test 4 failed: first burst not sent whole");
+            exchange();
+            test_err_if(marked == 0 or echoes == 0, "test 4 failed: marks not echoed");
+
+            written += client.write(data.substr(written));
+            test_err_if(client.bytes_in_flight() >= 10000, "test 4 failed: window not reduced");
+            exchange();
+
+            const string received = server.inbound_stream().read(server.inbound_stream().buffer_size());
+            test_err_if(written != data.size() or received != data, "test 4 failed: data lost");
+            test_err_if(reductions == 0, "test 4 failed: no CWR sent");
+            test_err_if(reductions > marked, "test 4 failed: more reductions than marks");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.keepalive_idle_ms = 5000;
+        cfg.keepalive_interval_ms = 1000;
+        cfg.keepalive_probes = 3;
+        const WrappingInt32 tx_isn{1000};
+        const WrappingInt32 rx_isn{2000};
+
+        // test #1: an idle connection probes with seqno - 1, and an answer restarts the idle period
+        {
+            TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_1.execute(ExpectNextDeadline{5000u}, "test 1 failed: keepalive not scheduled");
+            test_1.execute(Tick(4999));
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: probe before the idle time");
+            test_1.execute(Tick(1));
+            test_1.execute(ExpectOneSegment{}.with_no_flags().with_ack(true).with_seqno(tx_isn).with_payload_size(0),
+                           "test 1 failed: no keepalive probe");
+            test_1.execute(ExpectNextDeadline{1000u});
+
+            test_1.send_ack(rx_isn + 1, tx_isn + 1);
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: ACK of a probe was answered");
+            test_1.execute(ExpectNextDeadline{5000u}, "test 1 failed: answer didn't restart the idle period");
+            test_1.execute(ExpectState{State::ESTABLISHED});
+        }
+
+        // test #2: after keepalive_probes unanswered probes, the connection is reset
+        {
+            TCPTestHarness test_2 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_2.execute(Tick(5000));
+            for (unsigned i = 0; i < 3; i++) {
+                if (i > 0) {
+                    test_2.execute(Tick(1000));
+                }
+                test_2.execute(ExpectOneSegment{}.with_seqno(tx_isn).with_payload_size(0),
+                               "test 2 failed: missing probe " + to_string(i));
+            }
+            test_2.execute(Tick(999));
+            test_2.execute(ExpectState{State::ESTABLISHED});
+            test_2.execute(Tick(1));
+            test_2.execute(ExpectState{State::RESET});
+            test_2.execute(ExpectOneSegment{}.with_rst(true), "test 2 failed: no RST after the last probe");
+        }
+
+        // test #3: data in flight leaves the peer to the retransmission timer
+        {
+            TCPTestHarness test_3 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_3.execute(Write{"hello"});
+            test_3.execute(ExpectOneSegment{}.with_data("hello"));
+            test_3.execute(ExpectNextDeadline{cfg.rt_timeout});
+            test_3.send_ack(rx_isn + 1, tx_isn + 6);
+            test_3.execute(ExpectNextDeadline{5000u});
+        }
+
+        // test #4: a probe from the peer is answered with an ACK
+        {
+            TCPTestHarness test_4 = TCPTestHarness::in_established(TCPConfig{}, tx_isn, rx_isn);
+            test_4.execute(ExpectNextDeadline{nullopt}, "test 4 failed: keepalive is on by default");
+            test_4.send_ack(rx_isn, tx_isn + 1);
+            test_4.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1).with_seqno(tx_isn + 1),
+                           "test 4 failed: probe not answered");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
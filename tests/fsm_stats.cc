@@ -0,0 +1,78 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.send_capacity = 2000;
+        const WrappingInt32 tx_isn{1000};
+        const WrappingInt32 rx_isn{5000};
+
+        TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+        TCPConnectionStats stats = test_1._fsm.stats();
+        test_err_if(stats.state != TCPState::State::ESTABLISHED, "state not reported");
+        test_err_if(stats.segments_in != 1 or stats.segments_out != 2, "handshake segments not counted");
+        test_err_if(stats.cwnd != TCPSender::UNLIMITED_CWND, "congestion window limited without congestion");
+
+        // the peer's window holds back half of what was written; then the writer blocks on a full stream. As in
+        // TCPSpongeSocket, each event is followed by a tick, which covers the time *before* that event.
+        test_1.send_ack(rx_isn + 1, tx_isn + 1, 1000);
+        test_1.execute(Write{string(3000, 'x')}.with_bytes_written(2000));
+        test_1.execute(ExpectOneSegment{}.with_payload_size(1000));
+        test_1.execute(Tick(0));
+        test_1.execute(Tick(100));
+        test_1.execute(Write{string(1000, 'x')}.with_bytes_written(1000));
+        test_1.execute(Tick(50));
+        test_1.execute(Tick(50));
+        stats = test_1._fsm.stats();
+        test_err_if(stats.peer_window != 1000 or stats.bytes_in_flight != 1000, "window or flight wrong");
+        test_err_if(stats.rwnd_limited_ms != 150, "time before the write not charged to the receive window");
+        test_err_if(stats.sndbuf_limited_ms != 50, "time limited by the send buffer wrong");
+
+        // a duplicate ACK, then a retransmission at the RTO
+        test_1.send_ack(rx_isn + 1, tx_isn + 1, 1000);
+        test_1.execute(Tick(800));
+        test_1.execute(ExpectOneSegment{}.with_payload_size(1000).with_seqno(tx_isn + 1));
+        stats = test_1._fsm.stats();
+        test_err_if(stats.dup_acks != 1, "duplicate ACK not counted");
+        test_err_if(stats.segments_retransmitted != 1 or stats.bytes_retransmitted != 1000,
+                    "retransmission not counted");
+        test_err_if(stats.rto_ms != 2000, "RTO backoff not reported");
+        test_err_if(stats.sndbuf_limited_ms != 850, "time limited by the send buffer wrong");
+
+        // the window opens: everything goes out and the sender waits for the application
+        test_1.send_ack(rx_isn + 1, tx_isn + 1001, 10000);
+        test_1.execute(ExpectSegment{}.with_payload_size(1000));
+        test_1.execute(ExpectOneSegment{}.with_payload_size(1000));
+        test_1.execute(Tick(0));
+        test_1.execute(Tick(30));
+        test_1.execute(SendSegment{}.with_ack(true).with_seqno(rx_isn + 1).with_ackno(tx_isn + 1001).with_win(10000)
+                           .with_data("hello"));
+        test_1.execute(ExpectOneSegment{}.with_ackno(rx_isn + 6));
+        stats = test_1._fsm.stats();
+        test_err_if(stats.bytes_acked != 1000 or stats.bytes_in_flight != 2000, "acknowledged bytes wrong");
+        test_err_if(stats.bytes_received != 5, "received bytes wrong");
+        test_err_if(stats.app_limited_ms != 30, "time limited by the application wrong");
+        test_err_if(stats.rwnd_limited_ms != 150 or stats.cwnd_limited_ms != 0, "limited times changed");
+        test_err_if(stats.sndbuf_limited_ms != 850, "time after the window opened charged to the send buffer");
+        test_err_if(stats.rto_ms != 1000, "RTO not reset by the ACK");
+        test_err_if(stats.segments_in != 5 or stats.segments_out != 7, "segments not counted");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        TCPConfig cfg{};
+        cfg.timestamps = true;
+
+        // test 1: passive open negotiates timestamps, echoes TSval, and PAWS drops an old segment
+        {
+            const WrappingInt32 isn(rd());
+            TCPTestHarness test_1(cfg);
+            test_1.execute(Listen{});
+            test_1.execute(SendSegment{}.with_syn(true).with_seqno(isn).with_win(1000).with_ts(100, 0));
+
+            TCPSegment syn_ack =
+                test_1.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(isn + 1),
+                                  "test 1 failed: no SYN/ACK");
+            test_err_if(not syn_ack.header().ts.has_value(), "test 1 failed: SYN/ACK without timestamps");
+            test_err_if(syn_ack.header().ts->ecr != 100, "test 1 failed: SYN/ACK did not echo the SYN's TSval");
+            const WrappingInt32 tx_isn = syn_ack.header().seqno;
+
+            test_1.execute(Tick(5));
+            test_1.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(isn + 1)
+                               .with_ackno(tx_isn + 1)
+                               .with_win(1000)
+                               .with_ts(101, syn_ack.header().ts->val));
+            test_1.execute(ExpectState{State::ESTABLISHED});
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: ACK after acceptable ACK");
+
+            test_1.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(isn + 1)
+                               .with_ackno(tx_isn + 1)
+                               .with_win(1000)
+                               .with_ts(102, syn_ack.header().ts->val)
+                               .with_data("abc"));
+            TCPSegment ack = test_1.expect_seg(ExpectOneSegment{}.with_ack(true).with_ackno(isn + 4),
+                                               "test 1 failed: data not acknowledged");
+            test_err_if(not ack.header().ts.has_value() or ack.header().ts->ecr != 102,
+                        "test 1 failed: ACK did not echo the data segment's TSval");
+            test_err_if(ack.header().ts->val - syn_ack.header().ts->val != 5,
+                        "test 1 failed: TSval did not follow the passage of time");
+            test_1.execute(ExpectData{}.with_data("abc"));
+
+            // an old duplicate (TSval in the past) is acknowledged but its data is not accepted
+            test_1.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(isn + 4)
+                               .with_ackno(tx_isn + 1)
+                               .with_win(1000)
+                               .with_ts(90, syn_ack.header().ts->val)
+                               .with_data("xyz"));
+            test_1.execute(ExpectOneSegment{}.with_ack(true).with_ackno(isn + 4),
+                           "test 1 failed: PAWS-rejected segment was not acknowledged");
+            test_1.execute(ExpectNoData{}, "test 1 failed: PAWS-rejected data was accepted");
+        }
+
+        // test 2: an echoed timestamp gives an RTT sample, which shortens the RTO
+        {
+            const WrappingInt32 isn(rd());
+            TCPTestHarness test_2(cfg);
+            test_2.execute(Listen{});
+            test_2.execute(SendSegment{}.with_syn(true).with_seqno(isn).with_win(1000).with_ts(1, 0));
+            TCPSegment syn_ack = test_2.expect_seg(ExpectOneSegment{}.with_syn(true), "test 2 failed: no SYN/ACK");
+            const WrappingInt32 tx_isn = syn_ack.header().seqno;
+
+            test_2.execute(Tick(20));
+            test_2.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(isn + 1)
+                               .with_ackno(tx_isn + 1)
+                               .with_win(1000)
+                               .with_ts(2, syn_ack.header().ts->val));
+            test_2.execute(ExpectState{State::ESTABLISHED});
+
+            // 20 ms sample: SRTT 20, RTTVAR 10, so the RTO is clamped up to RTTEstimator::MIN_RTO_MS
+            test_2.execute(Write{"hello"});
+            test_2.execute(ExpectOneSegment{}.with_data("hello"), "test 2 failed: data not sent");
+            test_2.execute(Tick(RTTEstimator::MIN_RTO_MS - 1));
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: retransmission before the RTO");
+            test_2.execute(Tick(1));
+            test_2.execute(ExpectOneSegment{}.with_data("hello"),
+                           "test 2 failed: no retransmission after the measured RTO");
+        }
+
+        // test 3: a peer that does not offer timestamps gets none
+        {
+            const WrappingInt32 isn(rd());
+            TCPTestHarness test_3(cfg);
+            test_3.execute(Listen{});
+            test_3.send_syn(isn);
+            TCPSegment syn_ack = test_3.expect_seg(ExpectOneSegment{}.with_syn(true), "test 3 failed: no SYN/ACK");
+            test_err_if(syn_ack.header().ts.has_value(), "test 3 failed: timestamps sent to a peer that did not offer");
+        }
+
+        // test 4: active open offers timestamps and drops them when the SYN/ACK lacks the option
+        {
+            const WrappingInt32 isn(rd());
+            TCPTestHarness test_4(cfg);
+            test_4.execute(Connect{});
+            TCPSegment syn = test_4.expect_seg(ExpectOneSegment{}.with_syn(true), "test 4 failed: no SYN");
+            test_err_if(not syn.header().ts.has_value(), "test 4 failed: SYN did not offer timestamps");
+
+            test_4.send_syn(isn, syn.header().seqno + 1);
+            TCPSegment ack = test_4.expect_seg(ExpectOneSegment{}.with_ack(true).with_ackno(isn + 1),
+                                               "test 4 failed: SYN/ACK not acknowledged");
+            test_err_if(ack.header().ts.has_value(), "test 4 failed: timestamps used without agreement");
+        }
+
+        // test 5: with timestamps off (the default) the option is never sent
+        {
+            TCPTestHarness test_5(TCPConfig{});
+            test_5.execute(Connect{});
+            TCPSegment syn = test_5.expect_seg(ExpectOneSegment{}.with_syn(true), "test 5 failed: no SYN");
+            test_err_if(syn.header().ts.has_value(), "test 5 failed: timestamps offered when disabled");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
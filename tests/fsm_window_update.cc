@@ -0,0 +1,110 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+//! The application reads `bytes` from the inbound stream and tells the connection.
+struct ReadInbound : public TCPAction {
+    size_t bytes;
+
+    explicit ReadInbound(const size_t bytes_) : bytes(bytes_) {}
+
+    string description() const {
+        ostringstream o;
+        o << "application reads " << bytes << " bytes";
+        return o.str();
+    }
+
+    void execute(TCPTestHarness &harness) const {
+        harness._fsm.inbound_stream().pop_output(bytes);
+        harness._fsm.inbound_stream_read();
+    }
+};
+
+static SendSegment data_segment(const WrappingInt32 seqno, const WrappingInt32 ackno, const size_t size) {
+    return SendSegment{}.with_ack(true).with_seqno(seqno).with_ackno(ackno).with_win(1000).with_data(
+        string(size, 'x'));
+}
+
+int main() {
+    try {
+        const WrappingInt32 tx_isn{1000};
+        const WrappingInt32 rx_isn{5000};
+
+        // test #1: reads are announced only once the window has grown by an MSS
+        {
+            TCPConfig cfg{};
+            cfg.recv_capacity = 4000;
+            TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_1.execute(data_segment(rx_isn + 1, tx_isn + 1, 1000));
+            test_1.execute(ExpectOneSegment{}.with_ackno(rx_isn + 1001).with_win(3000));
+            test_1.execute(data_segment(rx_isn + 1001, tx_isn + 1, 1000));
+            test_1.execute(ExpectOneSegment{}.with_ackno(rx_isn + 2001).with_win(2000));
+
+            test_1.execute(ReadInbound{0});
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: window update without a read");
+            test_1.execute(ReadInbound{900});
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: window update for less than an MSS");
+            test_1.execute(ReadInbound{100});
+            test_1.execute(
+                ExpectOneSegment{}.with_no_flags().with_ack(true).with_ackno(rx_isn + 2001).with_win(3000).with_seqno(
+                    tx_isn + 1),
+                "test 1 failed: no window update after reading an MSS");
+            test_1.execute(ReadInbound{500});
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: window update repeated");
+        }
+
+        // test #2: with a small buffer, half of it is enough, so a closed window reopens promptly
+        {
+            TCPConfig cfg{};
+            cfg.recv_capacity = 1000;
+            TCPTestHarness test_2 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_2.execute(data_segment(rx_isn + 1, tx_isn + 1, 1000));
+            test_2.execute(ExpectOneSegment{}.with_ackno(rx_isn + 1001).with_win(0));
+
+            test_2.execute(ReadInbound{499});
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: window update for less than half the buffer");
+            test_2.execute(ReadInbound{1});
+            test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1001).with_win(500),
+                           "test 2 failed: closed window not reopened");
+        }
+
+        // test #3: the ACK of a zero-window probe keeps the edge too, instead of announcing a silly window
+        {
+            TCPConfig cfg{};
+            cfg.recv_capacity = 4000;
+            TCPTestHarness test_3 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            for (uint32_t offset = 0; offset < 4000; offset += 1000) {
+                test_3.execute(data_segment(rx_isn + 1 + offset, tx_isn + 1, 1000));
+                test_3.execute(ExpectOneSegment{}.with_ackno(rx_isn + 1001 + offset).with_win(3000 - offset));
+            }
+
+            test_3.execute(ReadInbound{100});
+            test_3.execute(ExpectNoSegment{}, "test 3 failed: window update for less than an MSS");
+            test_3.execute(data_segment(rx_isn + 4001, tx_isn + 1, 1));
+            test_3.execute(ExpectOneSegment{}.with_ackno(rx_isn + 4002).with_win(0),
+                           "test 3 failed: the probe's ACK announced a sub-MSS opening");
+
+            test_3.execute(ReadInbound{1400});
+            test_3.execute(ExpectOneSegment{}.with_ackno(rx_isn + 4002).with_win(1499),
+                           "test 3 failed: no window update after reading an MSS");
+            test_3.execute(data_segment(rx_isn + 4002, tx_isn + 1, 1));
+            test_3.execute(ExpectOneSegment{}.with_ackno(rx_isn + 4003).with_win(1498),
+                           "test 3 failed: the announced edge was not kept");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "buffer.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+//! Run `f`, which should throw: a runtime_error from a serializer, or an out_of_range from a full Headroom
+template <typename F>
+static void should_throw(F &&f) {
+    bool threw = false;
+    try {
+        f();
+    } catch (const runtime_error &) {
+        threw = true;
+    } catch (const logic_error &) {
+        threw = true;
+    }
+    test_should_be(threw, true);
+}
+
+int main() {
+    try {
+        // headers are prepended back to front into one allocation, and handed over without a copy
+        {
+            Headroom headroom{40};  // more than a short string holds inline, so the bytes are not moved
+            memcpy(headroom.prepend(4), "tail", 4);
+            memcpy(headroom.prepend(3), "mid", 3);
+            test_should_be(headroom.str() == "midtail", true);
+            should_throw([&] { headroom.prepend(34); });
+
+            const char *const front = headroom.str().data();
+            const Buffer headers = move(headroom).release();
+            test_should_be(headers.str() == "midtail", true);
+            test_should_be(headers.str().data() == front, true);
+        }
+
+        // a header refuses a span too small for it
+        {
+            TCPHeader header;
+            header.mss = 1460;
+            string too_small(TCPHeader::LENGTH, '\0');
+            should_throw([&] { header.serialize(too_small.data(), too_small.size()); });
+        }
+
+        // TCP in IPv4 serialized into one headroom matches the datagram built layer by layer, and parses
+        {
+            const FourTuple tuple{0x0a000001, 4242, 0x0a000002, 80};
+            TCPSegment seg;
+            seg.header().ack = true;
+            seg.header().seqno = WrappingInt32{1000};
+            seg.header().ackno = WrappingInt32{2000};
+            seg.header().ts = TCPHeader::Timestamps{123, 456};
+            seg.header().sack.push_back({WrappingInt32{3000}, WrappingInt32{4000}});
+            seg.set_payload(string(1001, 'p'));
+            seg.set_ecn(TCPSegment::ECN_ECT0);
+
+            const BufferList in_place = TCPOverIPv4Adapter::serialize_tcp_in_ip(tuple, seg);
+            test_should_be(in_place.buffers().size(), size_t{2});
+            const string wire = in_place.concatenate();
+            test_should_be(wire == TCPOverIPv4Adapter::wrap_tcp_in_ip(tuple, seg).serialize().concatenate(), true);
+
+            InternetDatagram dgram;
+            test_should_be(dgram.parse(string(wire)) == ParseResult::NoError, true);
+            test_should_be(dgram.header().tos, uint8_t{TCPSegment::ECN_ECT0});
+            TCPSegment parsed;
+            test_should_be(parsed.parse(dgram.payload(), dgram.header().pseudo_cksum()) == ParseResult::NoError,
+                           true);
+            test_should_be(parsed.header().sport, uint16_t{4242});
+            test_should_be(parsed.header().sack.size(), size_t{1});
+            test_should_be(parsed.payload().str() == string(1001, 'p'), true);
+
+            EthernetFrame frame;
+            frame.header().dst = ETHERNET_BROADCAST;
+            frame.header().src = {2, 0, 0, 0, 0, 1};
+            frame.header().type = EthernetHeader::TYPE_IPv4;
+            frame.payload() = dgram.serialize();
+            EthernetFrame parsed_frame;
+            test_should_be(parsed_frame.parse(frame.serialize().concatenate()) == ParseResult::NoError, true);
+            test_should_be(parsed_frame.header().src == frame.header().src, true);
+            test_should_be(parsed_frame.payload().concatenate() == wire, true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#ifndef SPONGE_MULTIPLEXER_HARNESS_HH
+#define SPONGE_MULTIPLEXER_HARNESS_HH
+
+#include "connection_table.hh"
+#include "tcp_listener.hh"
+#include "tcp_multiplexer.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+
+//! \name Clients 10.0.0.2:(10000 + i) talking to a server at 10.0.0.1:80, each end keeping its own
+//! connections in a TCPMultiplexer (or, for the server, a TCPListener)
+//!@{
+
+constexpr uint32_t CLIENT_IP = 0x0a000002;
+constexpr uint32_t SERVER_IP = 0x0a000001;
+constexpr uint16_t SERVER_PORT = 80;
+
+//! Client `i`'s connection, as the client sees it
+inline FourTuple client_tuple(const unsigned i) {
+    return {CLIENT_IP, static_cast<uint16_t>(10000 + i), SERVER_IP, SERVER_PORT};
+}
+
+//! Client `i`'s connection, as the server sees it
+inline FourTuple server_tuple(const unsigned i) {
+    return {SERVER_IP, SERVER_PORT, CLIENT_IP, static_cast<uint16_t>(10000 + i)};
+}
+
+//! The same connection, seen from the other end
+inline FourTuple reversed(const FourTuple &t) { return {t.remote_ip, t.remote_port, t.local_ip, t.local_port}; }
+
+//! Deliver everything the client has queued to the listener; \returns the last segment delivered
+inline TCPSegment to_listener(TCPMultiplexer &client, TCPListener &server) {
+    TCPSegment last;
+    while (not client.segments_out().empty()) {
+        auto &tagged = client.segments_out().front();
+        last = tagged.second;
+        server.segment_received(reversed(tagged.first), tagged.second);
+        client.segments_out().pop();
+    }
+    return last;
+}
+
+//! Deliver everything the listener has queued to the client; \returns the last segment delivered
+inline TCPSegment to_client(TCPListener &server, TCPMultiplexer &client) {
+    TCPSegment last;
+    while (not server.segments_out().empty()) {
+        auto &tagged = server.segments_out().front();
+        last = tagged.second;
+        client.segment_received(reversed(tagged.first), tagged.second);
+        server.segments_out().pop();
+    }
+    return last;
+}
+
+//!@}
+
+#endif  // SPONGE_MULTIPLEXER_HARNESS_HH
@@ -0,0 +1,92 @@
+#include "ring_queue.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // behaves like a FIFO queue while wrapping around and growing
+        {
+            RingQueue<string> ring{4};
+            deque<string> reference;
+            for (unsigned i = 0; i < 1000; i++) {
+                const unsigned pushes = i % 7;
+                for (unsigned j = 0; j < pushes; j++) {
+                    ring.push(to_string(i * 10 + j));
+                    reference.push_back(to_string(i * 10 + j));
+                }
+                const unsigned pops = min<size_t>(reference.size(), i % 5);
+                for (unsigned j = 0; j < pops; j++) {
+                    test_err_if(ring.front() != reference.front(), "front() out of order");
+                    ring.pop();
+                    reference.pop_front();
+                }
+                test_err_if(ring.size() != reference.size(), "size() mismatch");
+                for (size_t k = 0; k < reference.size(); k++) {
+                    test_err_if(ring[k] != reference[k], "operator[] mismatch");
+                }
+                if (not reference.empty()) {
+                    test_err_if(ring.back() != reference.back(), "back() mismatch");
+                }
+            }
+        }
+
+        // capacity stays put once the working size is reached, and popped slots are released
+        {
+            RingQueue<shared_ptr<int>> ring{2};
+            auto value = make_shared<int>(7);
+            for (unsigned i = 0; i < 100; i++) {
+                ring.push(value);
+                ring.push(value);
+                ring.pop();
+                ring.pop();
+            }
+            test_err_if(ring.capacity() != 2, "ring grew although it never held more than two elements");
+            test_err_if(value.use_count() != 1, "popped slot still holds its element");
+
+            ring.emplace(value);
+            ring.emplace(value);
+            ring.emplace(value);
+            test_err_if(ring.capacity() != 4, "ring did not grow when full");
+            ring.clear();
+            test_err_if(not ring.empty() or value.use_count() != 1, "clear() left elements behind");
+        }
+
+        // a default-constructed ring allocates nothing until the first push
+        {
+            RingQueue<string> ring;
+            test_err_if(ring.capacity() != 0, "default ring preallocated slots");
+            ring.push("a");
+            ring.push("b");
+            ring.push("c");
+            test_err_if(ring.capacity() != 4, "lazy ring grew to the wrong size");
+            test_err_if(ring.front() != "a" or ring.back() != "c", "lazy ring out of order");
+
+            // shrinking keeps the elements and their order
+            for (unsigned i = 0; i < 20; i++) {
+                ring.push(to_string(i));
+            }
+            for (unsigned i = 0; i < 20; i++) {
+                ring.pop();
+            }
+            ring.shrink_to_fit();
+            test_err_if(ring.capacity() != 4 or ring.size() != 3, "shrink_to_fit() kept the wrong capacity");
+            test_err_if(ring[0] != "17" or ring[1] != "18" or ring[2] != "19", "shrink_to_fit() lost elements");
+            ring.clear();
+            ring.shrink_to_fit();
+            test_err_if(ring.capacity() != 0, "empty ring kept its storage");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.persist_timer = true;
+
+            TCPSenderTestHarness test{"Zero window is probed one byte at a time, with backoff", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
+            test.execute(WriteBytes("abc"));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{0});
+
+            // first probe after the RTO, then 2x, 4x
+            size_t timeout = 1000;
+            for (unsigned int i = 0; i < 3; i++) {
+                test.execute(Tick{timeout - 1});
+                test.execute(ExpectNoSegment{});
+                test.execute(Tick{1});
+                test.execute(ExpectSegment{}.with_payload_size(1).with_data("a").with_seqno(isn + 1));
+                test.execute(ExpectBytesInFlight{1});
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
+                timeout *= 2;
+            }
+            // probes are not retransmissions
+            test.execute(Tick{timeout - 1}.with_max_retx_exceeded(false));
+
+            // the window opens: the unacknowledged probe is data again, and the rest follows
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(10));
+            test.execute(ExpectSegment{}.with_data("bc").with_seqno(isn + 2));
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1000 - 1});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.persist_timer = true;
+
+            TCPSenderTestHarness test{"A probe the peer accepts is acknowledged like data", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
+            test.execute(WriteBytes("ab"));
+            test.execute(Tick{1000});
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+            // the peer took the byte but its window is still closed: keep probing, with the next byte
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(0));
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{2000});
+            test.execute(ExpectSegment{}.with_data("b").with_seqno(isn + 2));
+            // the FIN is probed for the same way
+            test.execute(AckReceived{WrappingInt32{isn + 3}}.with_win(0));
+            test.execute(Close{});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{4000});
+            test.execute(ExpectSegment{}.with_fin(true).with_payload_size(0).with_seqno(isn + 3));
+            test.execute(AckReceived{WrappingInt32{isn + 4}}.with_win(0));
+            test.execute(ExpectState{TCPSenderStateSummary::FIN_ACKED});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.persist_timer = true;
+
+            TCPSenderTestHarness test{"Data in flight when the window closes is left to the RTO, with backoff", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(3));
+            test.execute(WriteBytes("abcdef"));
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(0));
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1000});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(Tick{1999});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            // once it is acknowledged, the persist timer takes over (at the backed-off RTO)
+            test.execute(AckReceived{WrappingInt32{isn + 4}}.with_win(0));
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+            cfg.persist_timer = true;
+
+            TCPSenderTestHarness test{"Once a probe took the last byte and the FIN, the persist timer stops", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
+            test.execute(WriteBytes("x"));
+            test.execute(Close{});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1000});
+            test.execute(ExpectSegment{}.with_data("x").with_fin(true).with_seqno(isn + 1));
+            test.execute(ExpectSeqno{WrappingInt32{isn + 3}});
+            // the peer takes both while keeping its window closed: there is nothing left to probe with
+            size_t timeout = 2000;
+            for (unsigned int i = 0; i < 4; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 3}}.with_win(0));
+                test.execute(Tick{timeout});
+                test.execute(ExpectNoSegment{});
+                timeout *= 2;
+            }
+            test.execute(ExpectSeqno{WrappingInt32{isn + 3}});
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(ExpectState{TCPSenderStateSummary::FIN_ACKED});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rack = true;
+
+            TCPSenderTestHarness test{"Tail loss probe resends the last segment after 2*SRTT", cfg};
+
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{10});
+            // 10 ms RTT sample: SRTT 10, so PTO = 20 ms while the RTO is clamped to 200 ms
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            test.execute(ExpectState{TCPSenderStateSummary::SYN_ACKED});
+            test.execute(WriteBytes("abc"));
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(WriteBytes("def"));
+            test.execute(ExpectSegment{}.with_data("def").with_seqno(isn + 4));
+            test.execute(Tick{19});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("def").with_seqno(isn + 4));
+            test.execute(ExpectNoSegment{});
+            // one probe per episode; after it the RTO (restarted by the probe) takes over
+            test.execute(Tick{199});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rack = true;
+
+            TCPSenderTestHarness test{"RACK resends a hole sent before an acknowledged retransmission", cfg};
+
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{10});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            test.execute(WriteBytes("a"));
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+            test.execute(WriteBytes("b"));
+            test.execute(ExpectSegment{}.with_data("b").with_seqno(isn + 2));
+            test.execute(Tick{20});
+            test.execute(ExpectSegment{}.with_data("b").with_seqno(isn + 2));
+            test.execute(Tick{200});
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+            // the retransmitted "a" is acknowledged 10 ms later: "b", last sent long before it, is lost
+            test.execute(Tick{10});
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            test.execute(ExpectSegment{}.with_data("b").with_seqno(isn + 2));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 3}}.with_win(1000));
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(Tick{1000});
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without RACK, a tail loss waits for the RTO", cfg};
+
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{10});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            test.execute(WriteBytes("abc"));
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(Tick{TCPConfig::TIMEOUT_DFLT - 1});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
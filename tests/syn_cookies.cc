@@ -0,0 +1,94 @@
+#include "isn_generator.hh"
+#include "siphash.hh"
+#include "tcp_header.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        // SipHash-2-4 reference vectors (key 00 01 .. 0f, message 00 01 .. len-1)
+        {
+            const SipHash hash{{0x0706050403020100, 0x0f0e0d0c0b0a0908}};
+            vector<uint8_t> message(15);
+            for (size_t i = 0; i < message.size(); i++) {
+                message[i] = static_cast<uint8_t>(i);
+            }
+            test_err_if(hash(message.data(), 0) != 0x726fdb47dd0e0e31, "wrong hash of the empty message");
+            test_err_if(hash(message.data(), 8) != 0x93f5f5799a932462, "wrong hash of an 8-byte message");
+            test_err_if(hash(message.data(), 15) != 0xa129ca6149be45e5, "wrong hash of a 15-byte message");
+        }
+
+        const SipHash::Key key{0x0123456789abcdef, 0xfedcba9876543210};
+        const FourTuple tuple{0x0a000001, 80, 0x0a000002, 40000};
+        const FourTuple other{0x0a000001, 80, 0x0a000002, 40001};
+
+        // ISNs advance with the 4-microsecond clock and differ between 4-tuples
+        {
+            IsnGenerator isn{key};
+            const WrappingInt32 first = isn.isn(tuple, 1000000);
+            test_err_if(isn.isn(tuple, 1000400) - first != 100, "ISN did not follow the clock");
+            test_err_if(isn.isn(tuple, 1000000) != first, "ISN is not a function of tuple and time");
+            test_err_if(isn.isn(other, 1000000) == first, "neighbouring tuples got the same ISN");
+            test_err_if(IsnGenerator{}.isn(tuple, 1000000) == first, "random key gave the fixed key's ISN");
+        }
+
+        // cookies round-trip the SYN's options
+        {
+            const SynCookies cookies{key};
+            const WrappingInt32 client_isn{123456};
+            const uint64_t now = 10 * SynCookies::PERIOD_MS + 5;
+            for (const optional<uint16_t> mss : {optional<uint16_t>{}, optional<uint16_t>{1460}}) {
+                for (const bool ts : {false, true}) {
+                    const WrappingInt32 cookie = cookies.encode(tuple, client_isn, {mss, ts}, now);
+                    const auto decoded = cookies.decode(tuple, client_isn, cookie, now);
+                    test_err_if(not decoded.has_value(), "valid cookie rejected");
+                    test_err_if(decoded->mss != mss or decoded->timestamps != ts, "cookie lost the SYN's options");
+                }
+            }
+
+            // an MSS between table entries is rounded down, and a tiny one is clamped to the minimum
+            const auto rounded = cookies.decode(
+                tuple, client_isn, cookies.encode(tuple, client_isn, {1300, false}, now), now);
+            test_err_if(not rounded.has_value() or rounded->mss != 1220, "MSS not rounded down");
+            const auto clamped =
+                cookies.decode(tuple, client_isn, cookies.encode(tuple, client_isn, {100, false}, now), now);
+            test_err_if(not clamped.has_value() or clamped->mss != 536, "small MSS not clamped");
+
+            // forgeries, mismatches and expired cookies are rejected
+            const WrappingInt32 cookie = cookies.encode(tuple, client_isn, {1460, true}, now);
+            test_err_if(cookies.decode(other, client_isn, cookie, now).has_value(), "accepted for another tuple");
+            test_err_if(cookies.decode(tuple, client_isn + 1, cookie, now).has_value(), "accepted another SYN");
+            test_err_if(cookies.decode(tuple, client_isn, cookie + 1, now).has_value(), "accepted a forged cookie");
+            test_err_if(SynCookies{}.decode(tuple, client_isn, cookie, now).has_value(), "accepted with another key");
+            const uint64_t last_valid = now + SynCookies::MAX_AGE * SynCookies::PERIOD_MS;
+            test_err_if(not cookies.decode(tuple, client_isn, cookie, last_valid).has_value(), "cookie expired early");
+            test_err_if(cookies.decode(tuple, client_isn, cookie, last_valid + SynCookies::PERIOD_MS).has_value(),
+                        "accepted an expired cookie");
+        }
+
+        // the MSS option survives serialization, next to Timestamps
+        {
+            TCPHeader header;
+            header.syn = true;
+            header.mss = 1460;
+            header.ts = TCPHeader::Timestamps{1, 2};
+            const string wire = header.serialize();
+            test_err_if(wire.size() != TCPHeader::LENGTH + 16, "unexpected options length");
+            TCPHeader parsed;
+            NetParser p{Buffer{string{wire}}};
+            test_err_if(parsed.parse(p) != ParseResult::NoError, "parse failed");
+            test_err_if(parsed.mss != header.mss or not(parsed.ts == header.ts), "options did not round-trip");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -11,6 +11,7 @@
 #include <exception>
 #include <optional>
 #include <sstream>
+#include <vector>
 
 struct TCPExpectation : public TCPTestStep {
     virtual ~TCPExpectation() {}
@@ -118,6 +119,8 @@ struct ExpectSegment : public TCPExpectation {
     std::optional<bool> rst{};
     std::optional<bool> syn{};
     std::optional<bool> fin{};
+    std::optional<bool> ece{};
+    std::optional<bool> cwr{};
     std::optional<WrappingInt32> seqno{};
     std::optional<WrappingInt32> ackno{};
     std::optional<uint16_t> win{};
@@ -144,6 +147,16 @@ struct ExpectSegment : public TCPExpectation {
         return *this;
     }
 
+    ExpectSegment &with_ece(bool ece_) {
+        ece = ece_;
+        return *this;
+    }
+
+    ExpectSegment &with_cwr(bool cwr_) {
+        cwr = cwr_;
+        return *this;
+    }
+
     ExpectSegment &with_no_flags() {
         ack = false;
         rst = false;
@@ -196,6 +209,12 @@ struct ExpectSegment : public TCPExpectation {
         if (fin.has_value()) {
             o << (fin.value() ? "F=1," : "F=0,");
         }
+        if (ece.has_value()) {
+            o << (ece.value() ? "E=1," : "E=0,");
+        }
+        if (cwr.has_value()) {
+            o << (cwr.value() ? "C=1," : "C=0,");
+        }
         if (ackno.has_value()) {
             o << "ackno=" << ackno.value() << ",";
         }
@@ -239,6 +258,12 @@ struct ExpectSegment : public TCPExpectation {
         if (fin.has_value() and seg.header().fin != fin.value()) {
             throw SegmentExpectationViolation::violated_field("fin", fin.value(), seg.header().fin);
         }
+        if (ece.has_value() and seg.header().ece != ece.value()) {
+            throw SegmentExpectationViolation::violated_field("ece", ece.value(), seg.header().ece);
+        }
+        if (cwr.has_value() and seg.header().cwr != cwr.value()) {
+            throw SegmentExpectationViolation::violated_field("cwr", cwr.value(), seg.header().cwr);
+        }
         if (seqno.has_value() and seg.header().seqno != seqno.value()) {
             throw SegmentExpectationViolation::violated_field("seqno", seqno.value(), seg.header().seqno);
         }
@@ -382,16 +407,47 @@ struct ExpectLingerTimer : public TCPExpectation {
     }
 };
 
+struct ExpectNextDeadline : public TCPExpectation {
+    std::optional<size_t> ms;
+
+    ExpectNextDeadline(std::optional<size_t> ms_) : ms(ms_) {}
+
+    std::string description() const {
+        std::ostringstream o;
+        if (ms.has_value()) {
+            o << "Next timer is due in " << ms.value() << " ms";
+        } else {
+            o << "No timer is running";
+        }
+        return o.str();
+    }
+
+    void execute(TCPTestHarness &harness) const {
+        const std::optional<size_t> actual_ms = harness._fsm.time_until_next_deadline();
+        if (actual_ms != ms) {
+            std::ostringstream o;
+            o << "The TCP reported its next deadline as "
+              << (actual_ms.has_value() ? std::to_string(actual_ms.value()) + " ms" : "none") << ", but it should be "
+              << (ms.has_value() ? std::to_string(ms.value()) + " ms" : "none");
+            throw TCPExpectationViolation(o.str());
+        }
+    }
+};
+
 struct SendSegment : public TCPAction {
     bool ack{false};
     bool rst{false};
     bool syn{false};
     bool fin{false};
+    bool ece{false};
+    bool cwr{false};
     WrappingInt32 seqno{0};
     WrappingInt32 ackno{0};
     uint16_t win{0};
     size_t payload_size{0};
     std::string data{};
+    std::optional<TCPHeader::Timestamps> ts{};
+    uint8_t ecn{TCPSegment::ECN_NOT_ECT};  //!< ECN codepoint of the datagram that brought the segment
 
     SendSegment() {}
 
@@ -400,10 +456,14 @@ struct SendSegment : public TCPAction {
         rst = seg.header().rst;
         syn = seg.header().syn;
         fin = seg.header().fin;
+        ece = seg.header().ece;
+        cwr = seg.header().cwr;
         seqno = seg.header().seqno;
         ackno = seg.header().ackno;
         win = seg.header().win;
+        ts = seg.header().ts;
         data = seg.payload();
+        ecn = seg.ecn();
     }
 
     SendSegment &with_ack(bool ack_) {
@@ -426,6 +486,21 @@ struct SendSegment : public TCPAction {
         return *this;
     }
 
+    SendSegment &with_ece(bool ece_) {
+        ece = ece_;
+        return *this;
+    }
+
+    SendSegment &with_cwr(bool cwr_) {
+        cwr = cwr_;
+        return *this;
+    }
+
+    SendSegment &with_ecn(uint8_t ecn_) {
+        ecn = ecn_;
+        return *this;
+    }
+
     SendSegment &with_seqno(WrappingInt32 seqno_) {
         seqno = seqno_;
         return *this;
@@ -445,6 +520,11 @@ struct SendSegment : public TCPAction {
         return *this;
     }
 
+    SendSegment &with_ts(uint32_t val, uint32_t ecr) {
+        ts = TCPHeader::Timestamps{val, ecr};
+        return *this;
+    }
+
     SendSegment &with_payload_size(size_t payload_size_) {
         payload_size = payload_size_;
         return *this;
@@ -457,15 +537,19 @@ struct SendSegment : public TCPAction {
 
     TCPSegment get_segment() const {
         TCPSegment data_seg;
-        data_seg.payload() = std::string(data);
+        data_seg.set_payload(std::string(data));
         auto &data_hdr = data_seg.header();
         data_hdr.ack = ack;
         data_hdr.rst = rst;
         data_hdr.syn = syn;
         data_hdr.fin = fin;
+        data_hdr.ece = ece;
+        data_hdr.cwr = cwr;
         data_hdr.ackno = ackno;
         data_hdr.seqno = seqno;
         data_hdr.win = win;
+        data_hdr.ts = ts;
+        data_seg.set_ecn(ecn);
         return data_seg;
     }
 
@@ -480,6 +564,9 @@ struct SendSegment : public TCPAction {
         } else {
             o << " with no payload";
         }
+        if (seg.ecn() == TCPSegment::ECN_CE) {
+            o << ", marked CE";
+        }
         return o.str();
     }
 
@@ -489,6 +576,34 @@ struct SendSegment : public TCPAction {
     }
 };
 
+struct SendSegmentBatch : public TCPAction {
+    std::vector<SendSegment> segments{};
+
+    SendSegmentBatch() {}
+
+    SendSegmentBatch &with_segment(const SendSegment &seg) {
+        segments.push_back(seg);
+        return *this;
+    }
+
+    virtual std::string description() const {
+        std::ostringstream o;
+        o << "batch of " << segments.size() << " packets arrives:";
+        for (const auto &seg : segments) {
+            o << "\n\t\t" << seg.description();
+        }
+        return o.str();
+    }
+
+    virtual void execute(TCPTestHarness &harness) const {
+        std::vector<TCPSegment> segs;
+        for (const auto &seg : segments) {
+            segs.push_back(seg.get_segment());
+        }
+        harness._fsm.segments_received(segs);
+    }
+};
+
 struct Write : public TCPAction {
     std::string data;
     std::optional<size_t> _bytes_written{};
@@ -31,7 +31,9 @@ struct ExpectSegmentAvailable;
 struct ExpectBytesInFlight;
 struct ExpectUnassembledBytes;
 struct ExpectWaitTimer;
+struct ExpectNextDeadline;
 struct SendSegment;
+struct SendSegmentBatch;
 struct Write;
 struct Tick;
 struct Connect;
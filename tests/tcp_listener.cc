@@ -0,0 +1,257 @@
+#include "multiplexer_harness.hh"
+#include "tcp_listener.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <set>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        TCPConfig cfg;
+        cfg.rt_timeout = 50;
+
+        // more clients than the backlogs hold: the excess SYNs are dropped and retried, and all get in
+        {
+            static constexpr unsigned CLIENTS = 500;
+            static constexpr size_t SYN_BACKLOG = 128;
+            static constexpr size_t ACCEPT_BACKLOG = 32;
+            TCPMultiplexer client{cfg};
+            TCPListener server{cfg, SYN_BACKLOG, ACCEPT_BACKLOG};
+
+            for (unsigned i = 0; i < CLIENTS; i++) {
+                client.connect(client_tuple(i));
+            }
+
+            set<uint16_t> accepted;
+            for (unsigned round = 0; round < 3000 and accepted.size() < CLIENTS; round++) {
+                to_listener(client, server);
+                test_err_if(server.syn_queue_size() > SYN_BACKLOG, "SYN queue overflowed");
+                to_client(server, client);
+                to_listener(client, server);  // the ACKs that complete handshakes
+                test_err_if(server.accept_queue_size() > ACCEPT_BACKLOG, "accept queue overflowed");
+
+                // the application accepts a few connections per round
+                for (unsigned n = 0; n < 16; n++) {
+                    const auto tuple = server.accept();
+                    if (not tuple.has_value()) {
+                        break;
+                    }
+                    test_err_if(not accepted.insert(tuple->remote_port).second, "accepted a connection twice");
+                    const string greeting = "welcome " + to_string(tuple->remote_port);
+                    server.connections().write(*tuple, greeting);
+                }
+                client.tick(10);
+                server.tick(10);
+            }
+            test_err_if(accepted.size() != CLIENTS, "not every client was accepted");
+            test_err_if(server.syns_dropped() == 0, "expected the backlog to drop some SYNs");
+            test_err_if(server.syn_queue_size() != 0, "half-open connections left over");
+
+            to_client(server, client);
+            for (unsigned i = 0; i < CLIENTS; i++) {
+                TCPConnection *conn = client.find(client_tuple(i));
+                test_err_if(conn == nullptr, "client connection vanished");
+                const string expected = "welcome " + to_string(10000 + i);
+                test_err_if(conn->inbound_stream().read(expected.size() + 1) != expected,
+                            "greeting delivered to the wrong client");
+            }
+        }
+
+        // a handshake that completes while the accept queue is full stays half-open until there is room
+        {
+            static constexpr size_t ACCEPT_BACKLOG = 2;
+            TCPMultiplexer client{cfg};
+            TCPListener server{cfg, 8, ACCEPT_BACKLOG};
+            for (unsigned i = 0; i <= ACCEPT_BACKLOG; i++) {
+                client.connect(client_tuple(i));
+            }
+            to_listener(client, server);
+            test_err_if(server.syn_queue_size() != ACCEPT_BACKLOG + 1, "SYNs not queued");
+            to_client(server, client);
+            to_listener(client, server);
+            test_err_if(server.accept_queue_size() != ACCEPT_BACKLOG, "accept queue not filled");
+            test_err_if(server.syn_queue_size() != 1 or server.acks_dropped() != 1, "overflowing ACK not dropped");
+            const TCPConnection *held = server.connections().find(server_tuple(ACCEPT_BACKLOG));
+            test_err_if(held == nullptr or held->handshake_complete(), "held connection completed anyway");
+
+            // once the application makes room, the peer's answer to the retransmitted SYN/ACK gets it in
+            test_err_if(not server.accept().has_value(), "nothing to accept");
+            for (unsigned round = 0; round < 20 and server.syn_queue_size() > 0; round++) {
+                server.tick(10);
+                client.tick(10);
+                to_client(server, client);
+                to_listener(client, server);
+            }
+            test_err_if(server.syn_queue_size() != 0, "held connection never completed");
+            test_err_if(server.accept_queue_size() != ACCEPT_BACKLOG, "held connection not queued for accept()");
+        }
+
+        // a half-open connection that never completes leaves the SYN queue after the timeout
+        {
+            TCPListener server{cfg, 8, 8, 1000};
+            TCPSegment syn;
+            syn.header().syn = true;
+            syn.header().seqno = WrappingInt32{5000};
+            server.segment_received(server_tuple(0), syn);
+            test_err_if(server.syn_queue_size() != 1, "SYN not queued");
+            test_err_if(server.segments_out().empty(), "no SYN/ACK sent");
+            server.segments_out().clear();
+
+            server.tick(999);
+            test_err_if(server.syn_queue_size() != 1, "half-open connection expired early");
+            server.tick(1);
+            test_err_if(server.syn_queue_size() != 0, "half-open connection did not expire");
+            test_err_if(server.connections().size() != 0, "expired connection kept");
+            test_err_if(server.accept().has_value(), "accepted an expired connection");
+        }
+
+        // a half-open connection that is reset leaves the SYN queue at once
+        {
+            TCPListener server{cfg};
+            TCPSegment syn;
+            syn.header().syn = true;
+            syn.header().seqno = WrappingInt32{5000};
+            server.segment_received(server_tuple(0), syn);
+
+            TCPSegment rst;
+            rst.header().rst = true;
+            rst.header().seqno = WrappingInt32{5001};
+            server.segment_received(server_tuple(0), rst);
+            test_err_if(server.syn_queue_size() != 0, "reset connection still half-open");
+            test_err_if(server.accept().has_value(), "accepted a reset connection");
+        }
+
+        // under a SYN flood with cookies on, no state is kept past the backlog, yet a real client gets in
+        {
+            TCPConfig ts_cfg = cfg;
+            ts_cfg.timestamps = true;
+            TCPListener server{ts_cfg, 4};
+            server.set_syn_cookies(true);
+
+            for (unsigned i = 0; i < 1000; i++) {
+                TCPSegment syn;
+                syn.header().syn = true;
+                syn.header().seqno = WrappingInt32{i * 7919};
+                server.segment_received({SERVER_IP, SERVER_PORT, 0xc0000000 + i, 1234}, syn);
+            }
+            test_err_if(server.syn_queue_size() != 4 or server.connections().size() != 4, "flood kept state");
+            test_err_if(server.cookies_sent() != 996, "flood not answered with cookies");
+            server.segments_out().clear();
+
+            // a client announcing a small MSS, with timestamps
+            TCPSegment syn;
+            syn.header().syn = true;
+            syn.header().seqno = WrappingInt32{1000};
+            syn.header().win = 5000;
+            syn.header().mss = 536;
+            syn.header().ts = TCPHeader::Timestamps{777, 0};
+            server.segment_received(server_tuple(0), syn);
+            test_err_if(server.segments_out().size() != 1, "no cookie SYN/ACK");
+            const TCPSegment synack = server.segments_out().front().second;
+            server.segments_out().pop();
+            test_err_if(not synack.header().syn or not synack.header().ack, "cookie reply is not a SYN/ACK");
+            test_err_if(synack.header().ackno != WrappingInt32{1001}, "cookie SYN/ACK has the wrong ackno");
+            test_err_if(not synack.header().ts.has_value() or synack.header().ts->ecr != 777, "timestamps not echoed");
+
+            // a forged final ACK is refused
+            TCPSegment forged;
+            forged.header().ack = true;
+            forged.header().seqno = WrappingInt32{1001};
+            forged.header().ackno = synack.header().seqno + 2;
+            server.segment_received(server_tuple(0), forged);
+            test_err_if(server.accept().has_value(), "accepted a forged cookie");
+            test_err_if(server.segments_out().empty() or not server.segments_out().front().second.header().rst,
+                        "forged cookie not reset");
+            server.segments_out().clear();
+
+            // the real final ACK creates the connection
+            TCPSegment ack;
+            ack.header().ack = true;
+            ack.header().seqno = WrappingInt32{1001};
+            ack.header().ackno = synack.header().seqno + 1;
+            ack.header().win = 5000;
+            ack.header().ts = TCPHeader::Timestamps{778, synack.header().ts->val};
+            server.segment_received(server_tuple(0), ack);
+            const auto accepted = server.accept();
+            test_err_if(not accepted.has_value() or *accepted != server_tuple(0), "cookie connection not accepted");
+            test_err_if(server.cookies_accepted() != 1, "cookie not counted");
+
+            // the connection uses the cookie's sequence numbers, MSS and timestamps
+            server.connections().write(server_tuple(0), string(2000, 'x'));
+            test_err_if(server.segments_out().size() != 4, "expected the MSS to split the data");
+            WrappingInt32 expected_seqno = synack.header().seqno + 1;
+            while (not server.segments_out().empty()) {
+                const TCPHeader &header = server.segments_out().front().second.header();
+                const size_t length = server.segments_out().front().second.payload().size();
+                test_err_if(length > 536, "segment larger than the peer's MSS");
+                test_err_if(header.seqno != expected_seqno, "data does not follow the cookie ISN");
+                test_err_if(not header.ts.has_value() or header.ts->ecr != 778, "timestamps not in use");
+                expected_seqno = expected_seqno + length;
+                server.segments_out().pop();
+            }
+        }
+
+        // cookie connections with timestamps carry data both ways with real clients, whatever the clients'
+        // and the tuples' timestamp offsets (the peer must never see our TSvals go backwards)
+        {
+            static constexpr unsigned CLIENTS = 32;
+            TCPConfig ts_cfg = cfg;
+            ts_cfg.timestamps = true;
+            TCPMultiplexer client{ts_cfg};
+            TCPListener server{ts_cfg, 0};  // no SYN queue: every SYN is answered with a cookie
+            server.set_syn_cookies(true);
+
+            for (unsigned i = 0; i < CLIENTS; i++) {
+                client.connect(client_tuple(i));
+            }
+            client.tick(7);
+            server.tick(1234);  // the listener's clock has moved on since it was created
+
+            set<uint16_t> accepted;
+            for (unsigned round = 0; round < 100; round++) {
+                to_listener(client, server);
+                to_client(server, client);
+                for (auto tuple = server.accept(); tuple.has_value(); tuple = server.accept()) {
+                    accepted.insert(tuple->remote_port);
+                    server.connections().write(*tuple, "hello " + to_string(tuple->remote_port));
+                }
+                client.tick(10);
+                server.tick(10);
+            }
+            test_err_if(accepted.size() != CLIENTS, "not every cookie connection was accepted");
+            test_err_if(server.cookies_accepted() != CLIENTS, "connections not created from cookies");
+
+            for (unsigned i = 0; i < CLIENTS; i++) {
+                client.write(client_tuple(i), "reply " + to_string(i));
+            }
+            for (unsigned round = 0; round < 100; round++) {
+                to_listener(client, server);
+                to_client(server, client);
+                client.tick(10);
+                server.tick(10);
+            }
+            for (unsigned i = 0; i < CLIENTS; i++) {
+                TCPConnection *conn = client.find(client_tuple(i));
+                test_err_if(conn == nullptr, "client connection vanished");
+                const string expected = "hello " + to_string(10000 + i);
+                test_err_if(conn->inbound_stream().read(expected.size() + 1) != expected,
+                            "data from a cookie connection did not reach its client");
+                TCPConnection *server_conn = server.connections().find(server_tuple(i));
+                test_err_if(server_conn == nullptr, "server connection vanished");
+                const string reply = "reply " + to_string(i);
+                test_err_if(server_conn->inbound_stream().read(reply.size() + 1) != reply,
+                            "data from a client did not reach its cookie connection");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
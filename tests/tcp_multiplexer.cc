@@ -0,0 +1,97 @@
+#include "multiplexer_harness.hh"
+#include "tcp_multiplexer.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! Deliver everything `from` has queued to `to`, seen from the other end; `drop_every` > 0 loses some segments.
+static size_t exchange(TCPMultiplexer &from, TCPMultiplexer &to, const size_t drop_every = 0) {
+    size_t count = 0;
+    while (not from.segments_out().empty()) {
+        auto &tagged = from.segments_out().front();
+        if (drop_every == 0 or ++count % drop_every != 0) {
+            to.segment_received(reversed(tagged.first), tagged.second);
+        }
+        from.segments_out().pop();
+    }
+    return count;
+}
+
+static void run(TCPMultiplexer &client, TCPMultiplexer &server, const size_t drop_every, const unsigned rounds) {
+    for (unsigned r = 0; r < rounds; r++) {
+        exchange(client, server, drop_every);
+        exchange(server, client, drop_every);
+        client.tick(10);
+        server.tick(10);
+    }
+}
+
+int main() {
+    try {
+        static constexpr unsigned FLOWS = 2000;
+        TCPConfig cfg;
+        cfg.rt_timeout = 50;
+
+        for (const size_t drop_every : {size_t{0}, size_t{7}}) {
+            TCPMultiplexer client{cfg};
+            TCPMultiplexer server{cfg};
+            server.set_listening(true);
+
+            // a segment for an unknown connection that isn't a SYN is refused
+            {
+                TCPSegment stray;
+                stray.header().ack = true;
+                stray.header().ackno = WrappingInt32{1234};
+                server.segment_received(server_tuple(FLOWS), stray);
+                test_err_if(server.size() != 0, "a stray segment created a connection");
+                test_err_if(server.segments_out().size() != 1, "a stray segment was not answered");
+                const auto &reply = server.segments_out().front();
+                test_err_if(reply.first != server_tuple(FLOWS), "RST sent to the wrong tuple");
+                test_err_if(not reply.second.header().rst or reply.second.header().seqno != WrappingInt32{1234},
+                            "expected an acceptable RST");
+                server.segments_out().pop();
+            }
+
+            for (unsigned i = 0; i < FLOWS; i++) {
+                client.connect(client_tuple(i));
+            }
+            run(client, server, drop_every, 100);
+            test_err_if(server.size() != FLOWS, "server did not accept every connection");
+
+            // each client sends its own message and closes
+            for (unsigned i = 0; i < FLOWS; i++) {
+                const string message = "hello from " + to_string(i);
+                test_err_if(client.write(client_tuple(i), message) != message.size(), "write() refused data");
+                client.end_input_stream(client_tuple(i));
+            }
+            run(client, server, drop_every, 100);
+
+            for (unsigned i = 0; i < FLOWS; i++) {
+                TCPConnection *conn = server.find(server_tuple(i));
+                test_err_if(conn == nullptr, "lost a server connection");
+                const string expected = "hello from " + to_string(i);
+                test_err_if(conn->inbound_stream().read(expected.size() + 1) != expected,
+                            "message delivered to the wrong connection");
+                test_err_if(not conn->inbound_stream().eof(), "missing FIN");
+                server.end_input_stream(server_tuple(i));
+            }
+            run(client, server, drop_every, 1000);
+
+            // both sides have read everything they were sent, so every finished connection is dropped
+            // (a server FIN whose ACK was lost is answered with a RST once the client has moved on)
+            test_err_if(server.size() != 0, "server kept finished connections");
+            test_err_if(client.size() != 0, "client kept finished connections");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
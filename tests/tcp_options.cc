@@ -0,0 +1,177 @@
+#include "parser.hh"
+#include "tcp_header.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+//! Serialize `header` and parse it back, checking that the serialized length was predicted correctly
+//! and that the parsed header equals the original (whose `doff` grew to fit the options).
+static TCPHeader round_trip(const TCPHeader &header) {
+    const string wire = header.serialize();
+    test_should_be(wire.size(), header.serialized_length());
+    test_should_be(wire.size() % 4, size_t{0});
+
+    NetParser p{string(wire)};
+    TCPHeader parsed;
+    if (parsed.parse(p) != ParseResult::NoError) {
+        throw runtime_error("round trip: serialized header does not parse");
+    }
+    test_should_be(p.buffer().size(), size_t{0});
+    test_should_be(size_t{4} * parsed.doff, wire.size());
+
+    TCPHeader expected = header;
+    expected.doff = parsed.doff;
+    test_should_be(parsed == expected, true);
+    return parsed;
+}
+
+//! A header with the given option bytes after the fixed part (padded with EOL to a multiple of four).
+static string with_options(string options) {
+    TCPHeader header;
+    header.doff = static_cast<uint8_t>((TCPHeader::LENGTH + options.size() + 3) / 4);
+    options.resize(4 * header.doff - TCPHeader::LENGTH);
+    return header.serialize().substr(0, TCPHeader::LENGTH) + options;
+}
+
+static TCPHeader::SackBlock block(const uint32_t left, const uint32_t right) {
+    TCPHeader::SackBlock b;
+    b.left = WrappingInt32{left};
+    b.right = WrappingInt32{right};
+    return b;
+}
+
+int main() {
+    try {
+        // a full SYN: every option that can go on one, with the longest Fast Open cookie, fits in 40 bytes
+        {
+            TCPHeader syn;
+            syn.syn = true;
+            syn.seqno = WrappingInt32{12345};
+            syn.mss = 1460;
+            syn.wscale = 7;
+            syn.sack_permitted = true;
+            syn.ts = TCPHeader::Timestamps{0xdeadbeef, 0};
+            TCPHeader::FastOpenCookie cookie;
+            cookie.length = TCPHeader::FastOpenCookie::MAX_LENGTH;
+            for (size_t i = 0; i < cookie.length; i++) {
+                cookie.bytes[i] = static_cast<uint8_t>(i * 17);
+            }
+            syn.fastopen = cookie;
+
+            test_should_be(syn.serialized_length(), TCPHeader::LENGTH + TCPHeader::MAX_OPTIONS_LENGTH);
+            const TCPHeader parsed = round_trip(syn);
+            test_should_be(parsed.wscale.value(), uint8_t{7});
+            test_should_be(parsed.sack_permitted, true);
+        }
+
+        // SACK-Permitted and Window Scale alone are padded with NOPs
+        {
+            TCPHeader syn;
+            syn.syn = true;
+            syn.sack_permitted = true;
+            syn.wscale = 0;
+            test_should_be(syn.serialized_length(), TCPHeader::LENGTH + 8);
+            round_trip(syn);
+        }
+
+        // an ACK with timestamps and as many SACK blocks as fit next to them
+        {
+            TCPHeader ack;
+            ack.ack = true;
+            ack.ackno = WrappingInt32{1000};
+            ack.ts = TCPHeader::Timestamps{7, 8};
+            test_should_be(ack.sack.push_back(block(3000, 4000)), true);
+            test_should_be(ack.sack.push_back(block(UINT32_MAX - 10, 5)), true);
+            test_should_be(ack.sack.push_back(block(2000, 2500)), true);
+            test_should_be(ack.sack.push_back(block(1, 2)), false);
+
+            test_should_be(ack.serialized_length(), TCPHeader::LENGTH + TCPHeader::MAX_OPTIONS_LENGTH);
+            const TCPHeader parsed = round_trip(ack);
+            test_should_be(parsed.sack.size(), size_t{3});
+            test_should_be(parsed.sack.blocks[1].left, WrappingInt32{UINT32_MAX - 10});
+            test_should_be(parsed.sack.blocks[1].right, WrappingInt32{5});
+        }
+
+        // no options: just the fixed header, and a reused header forgets the options it parsed before
+        {
+            TCPHeader plain;
+            plain.ack = true;
+            test_should_be(plain.serialized_length(), TCPHeader::LENGTH);
+
+            TCPHeader with_all;
+            with_all.sack_permitted = true;
+            with_all.wscale = 3;
+            with_all.sack.push_back(block(10, 20));
+            NetParser p{plain.serialize()};
+            test_should_be(with_all.parse(p) == ParseResult::NoError, true);
+            test_should_be(with_all == plain, true);
+        }
+
+        // a peer's four-block SACK (possible without timestamps) keeps the first three, most recent, blocks
+        {
+            string options = {1, 1, TCPHeader::OPT_SACK, 2 + 4 * TCPHeader::SACK_BLOCK_LEN};
+            for (uint32_t i = 0; i < 4; i++) {
+                NetUnparser::u32(options, 100 * i);
+                NetUnparser::u32(options, 100 * i + 50);
+            }
+            NetParser p{with_options(options)};
+            TCPHeader parsed;
+            test_should_be(parsed.parse(p) == ParseResult::NoError, true);
+            test_should_be(parsed.sack.size(), size_t{3});
+            test_should_be(parsed.sack.blocks[2].left, WrappingInt32{200});
+            test_should_be(p.buffer().size(), size_t{0});
+        }
+
+        // malformed and unknown options are skipped without losing the ones around them
+        {
+            string options = {TCPHeader::OPT_WSCALE, 4, 1, 2};  // Window Scale with the wrong length
+            options += {TCPHeader::OPT_SACK, 2};                // SACK without blocks
+            options += {TCPHeader::OPT_SACK_PERMITTED, 2};      // good
+            options += {30, 4, 0, 0};                           // an unknown kind
+            options += {TCPHeader::OPT_WSCALE, 3, 9};           // good
+            NetParser p{with_options(options)};
+            TCPHeader parsed;
+            test_should_be(parsed.parse(p) == ParseResult::NoError, true);
+            test_should_be(parsed.sack_permitted, true);
+            test_should_be(parsed.wscale.value(), uint8_t{9});
+            test_should_be(parsed.sack.empty(), true);
+        }
+
+        // an option whose length runs past the header is an error
+        {
+            const string options = {TCPHeader::OPT_SACK, 2 + 2 * TCPHeader::SACK_BLOCK_LEN, 0, 0};
+            NetParser p{with_options(options)};
+            TCPHeader parsed;
+            test_should_be(parsed.parse(p) == ParseResult::HeaderTooShort, true);
+        }
+
+        // options that do not fit in a header are refused
+        {
+            TCPHeader too_long;
+            too_long.mss = 1000;
+            too_long.ts = TCPHeader::Timestamps{};
+            too_long.sack.push_back(block(1, 2));
+            too_long.sack.push_back(block(3, 4));
+            too_long.sack.push_back(block(5, 6));
+            bool threw = false;
+            try {
+                too_long.serialize();
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+//! A segment from the peer `tuple` describes (as seen from our end), serialized and parsed back as a datagram
+static InternetDatagram from_peer(const FourTuple &tuple, TCPSegment seg) {
+    const FourTuple reversed{tuple.remote_ip, tuple.remote_port, tuple.local_ip, tuple.local_port};
+    InternetDatagram dgram;
+    if (dgram.parse(TCPOverIPv4Adapter::serialize_tcp_in_ip(reversed, seg).concatenate()) != ParseResult::NoError) {
+        throw runtime_error("from_peer: datagram does not parse");
+    }
+    return dgram;
+}
+
+int main() {
+    try {
+        TCPOverIPv4Adapter adapter;
+        adapter.config_mut().source = {"10.0.0.1", 4242};
+        adapter.config_mut().destination = {"10.0.0.2", 80};
+        const FourTuple tuple{0x0a000001, 4242, 0x0a000002, 80};
+
+        TCPSegment seg;
+        seg.header().ack = true;
+        seg.header().seqno = WrappingInt32{1000};
+        seg.set_payload(string(333, 'd'));
+
+        // the connection's segments are accepted, and checksummed with the cached pseudo-header sum
+        for (int round = 0; round < 3; round++) {
+            const auto unwrapped = adapter.unwrap_tcp_in_ip(from_peer(tuple, seg));
+            test_should_be(unwrapped.has_value(), true);
+            test_should_be(unwrapped->payload().size(), size_t{333});
+        }
+
+        // other ports are rejected (before the checksum), and so are bad checksums
+        {
+            test_should_be(adapter.unwrap_tcp_in_ip(from_peer({0x0a000001, 4243, 0x0a000002, 80}, seg)).has_value(),
+                           false);
+            test_should_be(adapter.unwrap_tcp_in_ip(from_peer({0x0a000001, 4242, 0x0a000002, 81}, seg)).has_value(),
+                           false);
+
+            InternetDatagram corrupt = from_peer(tuple, seg);
+            string payload = corrupt.payload().concatenate();
+            payload.back() ^= 1;
+            corrupt.payload() = move(payload);
+            test_should_be(adapter.unwrap_tcp_in_ip(corrupt).has_value(), false);
+        }
+
+        // a truncated segment is rejected without reading past it
+        {
+            InternetDatagram truncated = from_peer(tuple, seg);
+            truncated.payload() = string("\x10\x92\x00", 3);
+            test_should_be(adapter.unwrap_tcp_in_ip(truncated).has_value(), false);
+        }
+
+        // the cached sum follows a change of addresses
+        {
+            adapter.config_mut().destination = {"192.168.1.1", 80};
+            const FourTuple moved{0x0a000001, 4242, 0xc0a80101, 80};
+            test_should_be(adapter.unwrap_tcp_in_ip(from_peer(moved, seg)).has_value(), true);
+
+            InternetDatagram dgram;
+            test_should_be(dgram.parse(adapter.serialize_tcp_in_ip(seg).concatenate()) == ParseResult::NoError, true);
+            TCPSegment parsed;
+            test_should_be(parsed.parse(dgram.payload(), dgram.header().pseudo_cksum()) == ParseResult::NoError,
+                           true);
+        }
+
+        // pure ACKs come from the template, which follows a change of ports too
+        {
+            TCPSegment ack;
+            ack.header().ack = true;
+            ack.header().ackno = WrappingInt32{2000};
+            for (const uint16_t dport : {80, 8080}) {
+                adapter.config_mut().destination = {"192.168.1.1", dport};
+                InternetDatagram dgram;
+                test_should_be(dgram.parse(string(adapter.serialize_ack(ack))) == ParseResult::NoError, true);
+                test_should_be(dgram.header().dst, uint32_t{0xc0a80101});
+                TCPSegment parsed;
+                test_should_be(parsed.parse(dgram.payload(), dgram.header().pseudo_cksum()) == ParseResult::NoError,
+                               true);
+                test_should_be(parsed.header().dport, dport);
+                test_should_be(parsed.header().ackno == WrappingInt32{2000}, true);
+            }
+        }
+
+        // a listening adapter takes its peer from the SYN, then accepts only that peer
+        {
+            TCPOverIPv4Adapter listener;
+            listener.config_mut().source = {"0", 4242};
+            listener.set_listening(true);
+            test_should_be(listener.unwrap_tcp_in_ip(from_peer(tuple, seg)).has_value(), false);
+
+            TCPSegment syn;
+            syn.header().syn = true;
+            syn.header().seqno = WrappingInt32{999};
+            const FourTuple peer{0x0a000001, 4242, 0x0a000002, 5555};
+            test_should_be(listener.unwrap_tcp_in_ip(from_peer(peer, syn)).has_value(), true);
+            test_should_be(listener.listening(), false);
+
+            test_should_be(listener.unwrap_tcp_in_ip(from_peer(peer, seg)).has_value(), true);
+            test_should_be(listener.unwrap_tcp_in_ip(from_peer({0x0a000001, 4242, 0x0a000002, 5556}, seg)).has_value(),
+                           false);
+            test_should_be(listener.unwrap_tcp_in_ip(from_peer({0x0a000001, 4242, 0x0a000003, 5555}, seg)).has_value(),
+                           false);
+
+            TCPSegment ack;
+            ack.header().ack = true;
+            InternetDatagram dgram;
+            test_should_be(dgram.parse(string(listener.serialize_ack(ack))) == ParseResult::NoError, true);
+            test_should_be(dgram.header().src, uint32_t{0x0a000001});
+            test_should_be(dgram.header().dst, uint32_t{0x0a000002});
+            test_should_be(ack.header().sport, uint16_t{4242});
+            test_should_be(ack.header().dport, uint16_t{5555});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
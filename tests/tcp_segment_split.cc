@@ -0,0 +1,86 @@
+#include "tcp_segment.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // a super-segment carrying SYN, FIN and 2500 bytes splits into three pieces
+        {
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().fin = true;
+            seg.header().ack = true;
+            seg.header().seqno = WrappingInt32(UINT32_MAX - 5);
+            seg.header().ackno = WrappingInt32(77);
+            seg.header().win = 1234;
+            string data(2500, 'x');
+            for (size_t i = 0; i < data.size(); i++) {
+                data[i] = static_cast<char>('a' + i % 26);
+            }
+            seg.set_payload(string(data));
+
+            const auto pieces = seg.split(1000);
+            test_should_be(pieces.size(), size_t{3});
+
+            string rejoined;
+            size_t seq_space = 0;
+            for (size_t i = 0; i < pieces.size(); i++) {
+                const auto &h = pieces[i].header();
+                test_should_be(h.syn, i == 0);
+                test_should_be(h.fin, i == pieces.size() - 1);
+                test_should_be(h.ack, true);
+                test_should_be(h.ackno, WrappingInt32(77));
+                test_should_be(h.win, uint16_t{1234});
+                test_should_be(h.seqno, seg.header().seqno + static_cast<uint32_t>(seq_space));
+                seq_space += pieces[i].length_in_sequence_space();
+                rejoined += pieces[i].payload().copy();
+            }
+            test_should_be(rejoined == data, true);
+            test_should_be(seq_space, seg.length_in_sequence_space());
+
+            // the pieces' payloads are views into the super-segment's payload, not copies of it
+            const char *const base = seg.payload().str().data();
+            for (size_t i = 0; i < pieces.size(); i++) {
+                test_should_be(pieces[i].payload().str().data() == base + i * 1000, true);
+            }
+        }
+
+        // a sub-range of a Buffer shares its storage, and outlives the Buffer it was taken from
+        {
+            Buffer sub;
+            {
+                Buffer whole{string("0123456789")};
+                whole.remove_prefix(2);
+                sub = whole.substr(3, 4);
+                test_should_be(sub.str().data() == whole.str().data() + 3, true);
+                test_should_be(whole.substr(5).str() == "789", true);
+                test_should_be(whole.substr(8).size(), size_t{0});
+            }
+            test_should_be(sub.str() == "5678", true);
+            sub.remove_prefix(4);
+            test_should_be(sub.size(), size_t{0});
+        }
+
+        // a segment that already fits is returned unchanged
+        {
+            TCPSegment seg;
+            seg.header().seqno = WrappingInt32(42);
+            seg.set_payload(string(1000, 'y'));
+            const auto pieces = seg.split(1000);
+            test_should_be(pieces.size(), size_t{1});
+            test_should_be(pieces[0].header().seqno, WrappingInt32(42));
+            test_should_be(pieces[0].payload().size(), size_t{1000});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
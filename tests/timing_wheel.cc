@@ -0,0 +1,127 @@
+#include "test_err_if.hh"
+#include "timing_wheel.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // timers fire exactly at their deadline, across cascades, cancels and parked deadlines
+        {
+            TimingWheel wheel;
+            map<TimingWheel::TimerId, uint64_t> deadlines;
+            vector<TimingWheel::TimerId> ids;
+            size_t fired = 0;
+
+            auto add_timer = [&](const uint64_t delay_ms) {
+                const uint64_t deadline = wheel.now_ms() + delay_ms;
+                auto id = make_shared<TimingWheel::TimerId>();
+                *id = wheel.schedule(delay_ms, [&, id, deadline] {
+                    test_err_if(wheel.now_ms() != deadline,
+                                "timer due at " + to_string(deadline) + " fired at " + to_string(wheel.now_ms()));
+                    test_err_if(deadlines.erase(*id) != 1, "timer fired twice or after being cancelled");
+                    fired++;
+                });
+                deadlines[*id] = deadline;
+                ids.push_back(*id);
+            };
+
+            for (unsigned i = 0; i < 2000; i++) {
+                const unsigned kind = rd() % 10;
+                if (kind < 6) {
+                    add_timer(1 + rd() % 100);
+                } else if (kind < 9) {
+                    add_timer(1 + rd() % 500000);
+                } else {
+                    add_timer(1 + rd() % 20000000);  // beyond the wheel's range of 64^4 ticks
+                }
+            }
+            // cancel a tenth of them
+            for (unsigned i = 0; i < ids.size(); i += 10) {
+                const bool was_pending = deadlines.count(ids[i]) != 0;
+                test_err_if(wheel.cancel(ids[i]) != was_pending, "cancel() result does not match pending state");
+                deadlines.erase(ids[i]);
+                test_err_if(wheel.cancel(ids[i]), "cancel() succeeded twice");
+            }
+            test_err_if(wheel.size() != deadlines.size(), "size() does not count pending timers");
+
+            while (not deadlines.empty()) {
+                wheel.advance(1 + rd() % 5000);
+            }
+            test_err_if(wheel.size() != 0, "timers remain after all deadlines passed");
+            test_err_if(fired != ids.size() - (ids.size() + 9) / 10, "wrong number of timers fired");
+        }
+
+        // callbacks can reschedule themselves and cancel other timers
+        {
+            TimingWheel wheel{10};
+            unsigned periodic_count = 0;
+            bool victim_fired = false;
+            TimingWheel::TimerId victim = 0;
+
+            function<void()> periodic = [&] {
+                periodic_count++;
+                if (periodic_count < 5) {
+                    wheel.schedule(100, periodic);
+                }
+            };
+            wheel.schedule(100, periodic);
+            wheel.schedule(400, [&] { test_err_if(not wheel.cancel(victim), "victim was not pending"); });
+            victim = wheel.schedule(500, [&] { victim_fired = true; });
+
+            wheel.advance(95);
+            test_err_if(periodic_count != 0, "timer fired early");
+            wheel.advance(5);
+            test_err_if(periodic_count != 1, "timer did not fire on time");
+            wheel.advance(1000);
+            test_err_if(periodic_count != 5, "rescheduled timer did not run five times");
+            test_err_if(victim_fired, "cancelled timer fired");
+            test_err_if(wheel.size() != 0, "timers remain");
+        }
+
+        // a long idle stretch with no timers is skipped in one step
+        {
+            TimingWheel wheel;
+            wheel.advance(uint64_t{1} << 40);
+            bool fired = false;
+            wheel.schedule(3, [&] { fired = true; });
+            wheel.advance(2);
+            test_err_if(fired, "timer fired early after an idle stretch");
+            wheel.advance(1);
+            test_err_if(not fired, "timer did not fire after an idle stretch");
+        }
+
+        // a far-off timer is reached by jumping from one occupied slot to the next, not one tick at a time
+        {
+            TimingWheel wheel;
+            uint64_t keepalive_fired_at = 0;
+            uint64_t parked_fired_at = 0;
+            wheel.schedule(2 * 60 * 60 * 1000, [&] { keepalive_fired_at = wheel.now_ms(); });
+            wheel.schedule(uint64_t{1} << 38, [&] { parked_fired_at = wheel.now_ms(); });
+            wheel.advance(2 * 60 * 60 * 1000 - 1);
+            test_err_if(keepalive_fired_at != 0, "two-hour timer fired early");
+            wheel.advance(1);
+            test_err_if(keepalive_fired_at != 2 * 60 * 60 * 1000, "two-hour timer did not fire on time");
+            wheel.advance(uint64_t{1} << 40);
+            test_err_if(parked_fired_at != uint64_t{1} << 38, "parked timer did not fire on time");
+            test_err_if(wheel.now_ms() != (uint64_t{1} << 40) + 2 * 60 * 60 * 1000, "wheel lost time");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}